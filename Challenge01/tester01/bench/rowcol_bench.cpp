@@ -0,0 +1,154 @@
+// Times the RowCol parsers on a buffer of whitespace separated guesses:
+// the find_first_of/std::pow parser RowCol used before the lookup tables,
+// RowCol::from_string token by token and RowCol::from_buffer in one pass.
+//
+//   rowcol_bench [guesses] [rounds]
+
+#include "RowCol.hpp"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+// The parser RowCol::from_string replaced, kept as the baseline
+namespace legacy {
+
+bool from_chars(std::string_view const value, std::uint16_t &out)
+{
+    auto err = std::from_chars(value.data(), value.data() + value.size(), out);
+    return err.ec == std::errc();
+}
+
+int base26_from(std::string_view const letters)
+{
+    std::size_t numberLetters = letters.size();
+    int value = 0;
+    for (auto l : letters)
+    {
+        l = static_cast<char>(l | 0x20);
+        value += (l - 'a') * static_cast<int>(std::pow(26, numberLetters - 1));
+        --numberLetters;
+    }
+    return value;
+}
+
+RowCol from_string(std::string_view const value)
+{
+    if (value.size() < 2)
+        return {};
+
+    if (value[0] <= '9' and value[0] >= '0')
+    {
+        auto pos = value.find_first_of(",");
+        auto colText = value.substr(0, pos);
+        auto rowText = value.substr(pos + 1);
+        RowCol ret;
+        if (colText.size() && rowText.size() && from_chars(colText, ret.col) &&
+            from_chars(rowText, ret.row))
+            return ret;
+        return {};
+    }
+
+    auto pos = value.find_first_of("0123456789");
+    if (pos == std::string_view::npos)
+        return {};
+
+    RowCol ret;
+    if (from_chars(value.substr(pos), ret.row))
+    {
+        ret.col = static_cast<std::uint16_t>(base26_from(value.substr(0, pos)));
+        return ret;
+    }
+    return {};
+}
+} // namespace legacy
+
+// Splits on whitespace and parses each token with parse
+template <typename Parse>
+std::vector<RowCol> per_token(std::string_view buffer, Parse parse)
+{
+    std::vector<RowCol> guesses;
+    guesses.reserve(buffer.size() / 3);
+    std::size_t pos = 0;
+    while (pos < buffer.size())
+    {
+        pos = buffer.find_first_not_of(" \t\r\n", pos);
+        if (pos == std::string_view::npos)
+            break;
+        auto end = std::min(buffer.find_first_of(" \t\r\n", pos), buffer.size());
+        guesses.push_back(parse(buffer.substr(pos, end - pos)));
+        pos = end;
+    }
+    return guesses;
+}
+
+template <typename Run>
+double best_ns_per_guess(std::size_t guesses, int rounds, Run run)
+{
+    double best = 1e300;
+    for (int round = 0; round < rounds; ++round)
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto parsed = run();
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        if (parsed.size() != guesses)
+            std::abort();
+        best = std::min(
+            best, std::chrono::duration<double, std::nano>(elapsed).count() /
+                      static_cast<double>(guesses));
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::size_t guesses = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    int rounds = argc > 2 ? std::atoi(argv[2]) : 10;
+
+    // Half base26, half col,row, on boards up to 1000x1000
+    std::mt19937 random{42};
+    std::uniform_int_distribution<int> cell{0, 999};
+    std::string buffer;
+    char token[RowCol::max_colrow_chars];
+    for (std::size_t n = 0; n < guesses; ++n)
+    {
+        RowCol rc{static_cast<std::uint16_t>(cell(random)),
+                  static_cast<std::uint16_t>(cell(random))};
+        auto written = n % 2 ? rc.to_colrow_chars(token, token + sizeof(token))
+                             : rc.to_base26_chars(token, token + sizeof(token));
+        buffer.append(token, written.ptr);
+        buffer += n % 16 == 15 ? '\n' : ' ';
+    }
+
+    auto legacy = per_token(buffer, legacy::from_string);
+    auto batch = RowCol::from_buffer(buffer);
+    if (legacy != batch)
+    {
+        std::puts("from_buffer and the legacy parser disagree");
+        return 1;
+    }
+
+    std::printf("%zu guesses, best of %d rounds, ns per guess\n", guesses, rounds);
+    std::printf("  legacy from_string  %6.2f\n",
+                best_ns_per_guess(guesses, rounds, [&] {
+                    return per_token(buffer, legacy::from_string);
+                }));
+    std::printf("  RowCol::from_string %6.2f\n",
+                best_ns_per_guess(guesses, rounds, [&] {
+                    return per_token(buffer, RowCol::from_string);
+                }));
+    std::printf("  RowCol::from_buffer %6.2f\n",
+                best_ns_per_guess(guesses, rounds,
+                                  [&] { return RowCol::from_buffer(buffer); }));
+    return 0;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "TestDefinition.hpp"
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace Tests
+{
+
+enum class QueryPattern
+{
+    Range,
+    Row,
+    Col,
+    Diagonal
+};
+
+/**
+ * @brief Compact description of a structured set of queries (ranges, full rows
+ * or columns, diagonals). Only expanded into individual queries when needed.
+ */
+struct QuerySpec
+{
+    QueryPattern pattern{QueryPattern::Range};
+    RowCol first{};
+    RowCol last{};
+    std::uint16_t stride{1};
+
+    std::size_t size() const;
+
+    /**
+     * @brief Appends every query described by the spec to out
+     */
+    void expand(Queries &out) const;
+
+    static QuerySpec range(RowCol first, RowCol last, std::uint16_t stride = 1);
+    static QuerySpec full_row(const Definition &test, std::uint16_t row, std::uint16_t stride = 1);
+    static QuerySpec full_col(const Definition &test, std::uint16_t col, std::uint16_t stride = 1);
+    static QuerySpec diagonal(const Definition &test, std::uint16_t stride = 1);
+
+    static std::string_view pattern_name(QueryPattern pattern);
+    static std::optional<QueryPattern> pattern_from_name(std::string_view name);
+};
+
+using QuerySpecs = std::vector<QuerySpec>;
+
+} // namespace Tests
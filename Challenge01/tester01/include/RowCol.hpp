@@ -1,9 +1,11 @@
 #pragma once
+#include <charconv>
 #include <compare>
 #include <cstdint>
 #include <format>
 #include <string>
 #include <string_view>
+#include <vector>
 
 struct RowCol
 {
@@ -16,7 +18,29 @@ struct RowCol
 
     std::string as_colrow_fmt() const;
 
+    // Longest output of to_base26_chars ("dsyp65535") and to_colrow_chars ("65535,65535")
+    static constexpr std::size_t max_base26_chars = 9;
+    static constexpr std::size_t max_colrow_chars = 11;
+
+    /**
+     * @brief Allocation free version of as_base26_fmt, writes into [first, last)
+     */
+    std::to_chars_result to_base26_chars(char *first, char *last) const;
+
+    /**
+     * @brief Allocation free version of as_colrow_fmt, writes into [first, last)
+     */
+    std::to_chars_result to_colrow_chars(char *first, char *last) const;
+
     static RowCol random(std::uint16_t maxRow, std::uint16_t maxCol);
 
     static RowCol from_string(std::string_view const);
+
+    /**
+     * @brief Parses every whitespace or newline separated guess (base26 or
+     * col,row format) in buffer in a single pass.
+     * @return One RowCol per guess, invalid guesses are default initalized the
+     * same as from_string
+     */
+    static std::vector<RowCol> from_buffer(std::string_view const buffer);
 };
@@ -0,0 +1,43 @@
+#pragma once
+#include "RowCol.hpp"
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Formats a whole set of RowCol values into one contiguous buffer. Every
+ * entry is NUL terminated so it can be used as a string_view or handed to a
+ * process as an argv entry without a per value allocation.
+ */
+class RowColArena
+{
+  public:
+    enum class Format
+    {
+        Base26,
+        ColRow
+    };
+
+    RowColArena(std::span<const RowCol> values, Format format);
+
+    std::size_t size() const
+    {
+        return mOffsets.size() - 1;
+    }
+
+    std::string_view operator[](std::size_t index) const
+    {
+        return {mBuffer.data() + mOffsets[index], mOffsets[index + 1] - mOffsets[index] - 1};
+    }
+
+    const char *c_str(std::size_t index) const
+    {
+        return mBuffer.data() + mOffsets[index];
+    }
+
+  private:
+    std::string mBuffer;
+    std::vector<std::uint32_t> mOffsets;
+};
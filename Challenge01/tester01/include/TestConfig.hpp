@@ -1,5 +1,6 @@
 
 #pragma once
+#include "QuerySpec.hpp"
 #include "TestDefinition.hpp"
 #include <filesystem>
 
@@ -13,6 +14,18 @@ public:
     Queries queries{};
     QueryAnswers expected{};
     std::vector<std::string> rejected{};
+    QuerySpecs querySpecs{};
+
+    /***
+     * @details Explicit queries followed by the expansion of querySpecs
+     */
+    Queries all_queries() const;
+
+    /***
+     * @details Explicit expected answers followed by the answers for the
+     * queries expanded from querySpecs
+     */
+    QueryAnswers all_expected() const;
   };
 
 private:
@@ -30,11 +43,23 @@ public:
   void create_new_test(const Definition &test, std::size_t nbrQueries,
                        std::size_t outofbounds);
 
+  /***
+   * @details Creates a new test whose queries are described by query specs
+   * rather than listed one by one
+   * @param test Create the test based on a definition
+   * @param specs structured queries (ranges, rows, cols, diagonals)
+   * @param outofbounds specify the number of guarenteed out of bound queries
+   * are synthesize
+   */
+  void create_new_test(const Definition &test, QuerySpecs &&specs,
+                       std::size_t outofbounds);
+
   /***
    * @details Defines an existing test create
    */
   void add_existing(const Definition &test, std::string &&filename, Queries &&,
-                    QueryAnswers &&, std::vector<std::string> &&);
+                    QueryAnswers &&, std::vector<std::string> &&,
+                    QuerySpecs && = {});
 
   void write_all_tests(std::filesystem::path locationToWrite,
                        bool locateTestFileInSeperateFolder);
@@ -44,9 +69,11 @@ public:
   auto end() const { return mTests.cend(); }
 
 public:
-  static Configuration generate_default(bool includeErrors, bool generateHuge);
+  static Configuration generate_default(bool includeErrors, bool generateHuge,
+                                        bool generateSweep = false);
 
 private:
   void write_config_file(std::filesystem::path locationToWrite);
+  static void add_out_of_bounds(ExpectedResults &t, std::size_t outofbounds);
 };
 } // namespace Tests
@@ -1,6 +1,7 @@
 #pragma once
 #include "RowCol.hpp"
 #include <cstdint>
+#include <optional>
 #include <ostream>
 #include <string>
 #include <variant>
@@ -66,6 +67,13 @@ class Definition
 
     QueryAnswers generate(std::ostream &file, const std::vector<RowCol> &guesses) const;
 
+    /**
+     * @brief Computes the answer at pos without generating the data file.
+     * @return The answer, OOB when pos is outside the data or nothing if the
+     * data is random (the answer is only known after generate).
+     */
+    std::optional<QueryAnswer> expected_answer(RowCol pos) const;
+
   private:
     std::string make_row_value(std::size_t value, Errors err) const;
     std::string make_col_value(std::size_t value, Errors err) const;
@@ -1,9 +1,21 @@
 #pragma once
+#include <charconv>
 #include <string>
 
 namespace base26
 {
+// Letters needed for the largest int value
+inline constexpr std::size_t max_chars = 7;
+
 std::string to(int value);
+
+/**
+ * @brief Writes value as base26 letters into [first, last) without allocating
+ * @return ptr one past the last letter written, errc::value_too_large if the
+ * buffer is too small
+ */
+std::to_chars_result to_chars(char *first, char *last, int value);
+
 int from(std::string_view const letters);
 
-} // namespace base26
\ No newline at end of file
+} // namespace base26
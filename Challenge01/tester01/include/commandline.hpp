@@ -27,6 +27,7 @@ struct Options
     std::filesystem::path testProgram{};
     TestModes tests{TestModes::All};
     bool huge{false};
+    bool sweep{false};
     bool overwrite{false};
     int runTimeOutMilliseconds{500};
 };
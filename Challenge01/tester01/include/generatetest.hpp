@@ -3,4 +3,4 @@
 #include <filesystem>
 
 int generate_tests_cmd_line(std::filesystem::path test_output, CommandLine::TestModes mode, bool huge = false,
-                            bool overwrite = false);
+                            bool overwrite = false, bool sweep = false);
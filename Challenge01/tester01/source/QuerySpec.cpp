@@ -0,0 +1,104 @@
+#include "QuerySpec.hpp"
+#include <algorithm>
+
+using std::operator""sv;
+
+namespace Tests
+{
+
+std::size_t QuerySpec::size() const
+{
+    if (stride == 0 || last.row < first.row || last.col < first.col)
+        return 0;
+
+    const std::size_t rows = (last.row - first.row) / stride + 1;
+    const std::size_t cols = (last.col - first.col) / stride + 1;
+
+    if (pattern == QueryPattern::Diagonal)
+        return std::min(rows, cols);
+
+    return rows * cols;
+}
+
+void QuerySpec::expand(Queries &out) const
+{
+    const std::size_t count = size();
+    if (count == 0)
+        return;
+
+    out.reserve(out.size() + count);
+
+    if (pattern == QueryPattern::Diagonal)
+    {
+        for (std::size_t step = 0; step < count; ++step)
+        {
+            out.emplace_back(static_cast<std::uint16_t>(first.row + step * stride),
+                             static_cast<std::uint16_t>(first.col + step * stride));
+        }
+        return;
+    }
+
+    // Range, Row and Col only differ in how they are built. Loop in 32 bit so a
+    // last row/col of 65535 does not wrap.
+    for (std::uint32_t row = first.row; row <= last.row; row += stride)
+    {
+        for (std::uint32_t col = first.col; col <= last.col; col += stride)
+        {
+            out.emplace_back(static_cast<std::uint16_t>(row), static_cast<std::uint16_t>(col));
+        }
+    }
+}
+
+QuerySpec QuerySpec::range(RowCol first, RowCol last, std::uint16_t stride)
+{
+    return {QueryPattern::Range, first, last, stride};
+}
+
+QuerySpec QuerySpec::full_row(const Definition &test, std::uint16_t row, std::uint16_t stride)
+{
+    return {QueryPattern::Row, {row, 0}, {row, static_cast<std::uint16_t>(test.mNbrCols - 1)}, stride};
+}
+
+QuerySpec QuerySpec::full_col(const Definition &test, std::uint16_t col, std::uint16_t stride)
+{
+    return {QueryPattern::Col, {0, col}, {static_cast<std::uint16_t>(test.mNbrRows - 1), col}, stride};
+}
+
+QuerySpec QuerySpec::diagonal(const Definition &test, std::uint16_t stride)
+{
+    return {QueryPattern::Diagonal,
+            {0, 0},
+            {static_cast<std::uint16_t>(test.mNbrRows - 1), static_cast<std::uint16_t>(test.mNbrCols - 1)},
+            stride};
+}
+
+std::string_view QuerySpec::pattern_name(QueryPattern pattern)
+{
+    switch (pattern)
+    {
+    case QueryPattern::Row:
+        return "row"sv;
+    case QueryPattern::Col:
+        return "col"sv;
+    case QueryPattern::Diagonal:
+        return "diagonal"sv;
+    case QueryPattern::Range:
+    default:
+        return "range"sv;
+    }
+}
+
+std::optional<QueryPattern> QuerySpec::pattern_from_name(std::string_view name)
+{
+    if (name == "range"sv)
+        return QueryPattern::Range;
+    if (name == "row"sv)
+        return QueryPattern::Row;
+    if (name == "col"sv)
+        return QueryPattern::Col;
+    if (name == "diagonal"sv)
+        return QueryPattern::Diagonal;
+    return {};
+}
+
+} // namespace Tests
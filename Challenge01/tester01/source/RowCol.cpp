@@ -1,21 +1,40 @@
 #include "RowCol.hpp"
 #include "RandomUtil.hpp"
 #include <algorithm>
+#include <array>
 #include <charconv>
+#include <limits>
 #include <ranges>
 #include <utility>
 #include "base26.hpp"
 
 std::string RowCol::as_base26_fmt() const
 {
-    std::string result{ base26::to( col )};
-    result.append(std::to_string(row));
-    return result;
+    char buffer[max_base26_chars];
+    return std::string(buffer, to_base26_chars(buffer, buffer + max_base26_chars).ptr);
 }
 
 std::string RowCol::as_colrow_fmt() const
 {
-    return std::format("{},{}", col, row);
+    char buffer[max_colrow_chars];
+    return std::string(buffer, to_colrow_chars(buffer, buffer + max_colrow_chars).ptr);
+}
+
+std::to_chars_result RowCol::to_base26_chars(char *first, char *last) const
+{
+    auto result = base26::to_chars(first, last, col);
+    if (result.ec != std::errc{})
+        return result;
+    return std::to_chars(result.ptr, last, row);
+}
+
+std::to_chars_result RowCol::to_colrow_chars(char *first, char *last) const
+{
+    auto result = std::to_chars(first, last, col);
+    if (result.ec != std::errc{} || result.ptr == last)
+        return {last, std::errc::value_too_large};
+    *result.ptr = ',';
+    return std::to_chars(result.ptr + 1, last, row);
 }
 
 RowCol RowCol::random(std::uint16_t maxRow, std::uint16_t maxCol)
@@ -23,34 +42,116 @@ RowCol RowCol::random(std::uint16_t maxRow, std::uint16_t maxCol)
     return {Random::between<std::uint16_t>(0, maxRow), Random::between<std::uint16_t>(0, maxCol)};
 }
 
-bool from_chars(std::string_view const value, std::uint16_t &out)
+namespace
 {
-    auto err = std::from_chars(value.data(), value.data() + value.size(), out);
-    if (err.ec == std::errc())
-        return true;
-    return false;
+
+enum CharClass : std::uint8_t
+{
+    Other,
+    Digit,
+    Letter,
+    Comma,
+    Space
+};
+
+constexpr std::array<std::uint8_t, 256> make_char_classes()
+{
+    std::array<std::uint8_t, 256> table{};
+    for (int c = '0'; c <= '9'; ++c)
+        table[c] = Digit;
+    for (int c = 'a'; c <= 'z'; ++c)
+        table[c] = Letter;
+    for (int c = 'A'; c <= 'Z'; ++c)
+        table[c] = Letter;
+    table[static_cast<unsigned char>(',')] = Comma;
+    for (unsigned char c : {' ', '\t', '\n', '\r', '\v', '\f'})
+        table[c] = Space;
+    return table;
 }
 
-RowCol parse_comma_fmt(const std::string_view value)
+// Numeric value of a digit or letter, letters are case insensitive with a = 0
+constexpr std::array<std::uint8_t, 256> make_char_values()
 {
-    auto pos = value.find_first_of(",");
-    auto colText = value.substr(0, pos);
-    auto rowText = value.substr(pos + 1);
+    std::array<std::uint8_t, 256> table{};
+    for (int c = '0'; c <= '9'; ++c)
+        table[c] = static_cast<std::uint8_t>(c - '0');
+    for (int c = 'a'; c <= 'z'; ++c)
+        table[c] = static_cast<std::uint8_t>(c - 'a');
+    for (int c = 'A'; c <= 'Z'; ++c)
+        table[c] = static_cast<std::uint8_t>(c - 'A');
+    return table;
+}
+
+constexpr auto char_classes = make_char_classes();
+constexpr auto char_values = make_char_values();
 
-    if (colText.size() == 0 || rowText.size() == 0)
+constexpr std::uint32_t max_position = std::numeric_limits<std::uint16_t>::max();
+
+inline std::uint8_t class_of(char c)
+{
+    return char_classes[static_cast<unsigned char>(c)];
+}
+
+inline std::uint8_t value_of(char c)
+{
+    return char_values[static_cast<unsigned char>(c)];
+}
+
+/**
+ * @brief Accumulates a run of characters of one class in the given base
+ * @return false if the run is empty or the value does not fit in 16 bits
+ */
+bool accumulate(const char *&pos, const char *end, std::uint8_t charClass, std::uint32_t base, std::uint32_t &out)
+{
+    const char *start = pos;
+    std::uint32_t value = 0;
+    while (pos != end && class_of(*pos) == charClass)
     {
-        return {};
+        value = value * base + value_of(*pos);
+        if (value > max_position)
+            return false;
+        ++pos;
     }
+    out = value;
+    return pos != start;
+}
 
-    RowCol ret;
+/**
+ * @brief Parses the token starting at pos (base26 or col,row format)
+ * @return Pointer one past the token. out is default initalized if the token
+ * is invalid
+ */
+const char *parse_token(const char *pos, const char *end, RowCol &out)
+{
+    out = {};
+    std::uint32_t col{0};
+    std::uint32_t row{0};
+    bool valid = false;
+
+    if (class_of(*pos) == Digit)
+    {
+        valid = accumulate(pos, end, Digit, 10, col) && pos != end && class_of(*pos) == Comma &&
+                accumulate(++pos, end, Digit, 10, row);
+    }
+    else if (class_of(*pos) == Letter)
+    {
+        valid = accumulate(pos, end, Letter, 26, col) && accumulate(pos, end, Digit, 10, row);
+    }
 
-    if (from_chars(colText, ret.col) && from_chars(rowText, ret.row))
+    if (valid && (pos == end || class_of(*pos) == Space))
     {
-        return ret;
+        out.row = static_cast<std::uint16_t>(row);
+        out.col = static_cast<std::uint16_t>(col);
+        return pos;
     }
-    return {};
+
+    // Skip the remainder of an invalid token
+    while (pos != end && class_of(*pos) != Space)
+        ++pos;
+    return pos;
 }
 
+} // namespace
 
 /**
  * @brief Converts a trimmed string (no whitespace allowed base26 or col,row format)
@@ -59,28 +160,36 @@ RowCol parse_comma_fmt(const std::string_view value)
  */
 RowCol RowCol::from_string(std::string_view const value)
 {
-    if( value.size() < 2 )
+    if (value.size() < 2)
         return {};
 
-    if( value[0] <= '9' and value[0] >= '0' ) {
-        // Assume comma format
-        return parse_comma_fmt(value);
-    }
-    
-    auto pos = value.find_first_of("0123456789");
-    if (pos == std::string_view::npos)
-    {
+    RowCol ret;
+    const char *end = value.data() + value.size();
+    if (parse_token(value.data(), end, ret) != end)
         return {};
-    }
 
-    auto letters = value.substr(0, pos);
-    
-    RowCol ret;
-    if (from_chars(value.substr(pos), ret.row))
+    return ret;
+}
+
+std::vector<RowCol> RowCol::from_buffer(std::string_view const buffer)
+{
+    std::vector<RowCol> guesses;
+    // Shortest guess is two characters plus a separator
+    guesses.reserve(buffer.size() / 3);
+
+    const char *pos = buffer.data();
+    const char *end = pos + buffer.size();
+    while (pos != end)
     {
-        ret.col = static_cast<std::uint16_t>(base26::from(letters));
-        return ret;
-    }
+        if (class_of(*pos) == Space)
+        {
+            ++pos;
+            continue;
+        }
 
-    return {};
-}
\ No newline at end of file
+        RowCol guess;
+        pos = parse_token(pos, end, guess);
+        guesses.push_back(guess);
+    }
+    return guesses;
+}
@@ -0,0 +1,22 @@
+#include "RowColArena.hpp"
+
+RowColArena::RowColArena(std::span<const RowCol> values, Format format)
+{
+    const std::size_t maxChars = format == Format::Base26 ? RowCol::max_base26_chars : RowCol::max_colrow_chars;
+
+    // Size for the worst case once, then trim to what was written
+    mBuffer.resize(values.size() * (maxChars + 1));
+    mOffsets.reserve(values.size() + 1);
+    mOffsets.push_back(0);
+
+    char *pos = mBuffer.data();
+    for (const auto &value : values)
+    {
+        char *last = pos + maxChars;
+        pos = (format == Format::Base26 ? value.to_base26_chars(pos, last) : value.to_colrow_chars(pos, last)).ptr;
+        *pos++ = '\0';
+        mOffsets.push_back(static_cast<std::uint32_t>(pos - mBuffer.data()));
+    }
+
+    mBuffer.resize(mOffsets.back());
+}
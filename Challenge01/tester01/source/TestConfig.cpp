@@ -71,6 +71,41 @@ void Configuration::create_new_test(const Definition &test,
   auto duplicates = std::ranges::unique(t.queries);
   t.queries.erase(duplicates.begin(), duplicates.end());
 
+  add_out_of_bounds(t, outofbounds);
+
+  mTests.emplace_back(t);
+}
+
+void Configuration::create_new_test(const Definition &test, QuerySpecs &&specs,
+                                    std::size_t outofbounds) {
+  ExpectedResults t{test};
+
+  if (test.mError != Errors::None) {
+    mTests.emplace_back(std::move(t));
+    return;
+  }
+
+  t.rejected.emplace_back("error");
+
+  // Random data only has known answers once the data file is written so the
+  // specs are listed as plain queries and answered by generate().
+  if (test.mData == RowColDataGeneration::Random) {
+    for (const auto &spec : specs) {
+      spec.expand(t.queries);
+    }
+  } else {
+    t.querySpecs = std::move(specs);
+  }
+
+  add_out_of_bounds(t, outofbounds);
+
+  mTests.emplace_back(std::move(t));
+}
+
+void Configuration::add_out_of_bounds(ExpectedResults &t,
+                                      std::size_t outofbounds) {
+  const Definition &test = t.test;
+
   // Generate Out of bound queries
   for (std::size_t oobCount = 0; oobCount < outofbounds; ++oobCount) {
     RowCol oob{
@@ -80,14 +115,48 @@ void Configuration::create_new_test(const Definition &test,
     t.queries.push_back(oob);
     t.expected.emplace_back(true, oob, 0);
   }
-
-  mTests.emplace_back(t);
 }
 
 void Configuration::add_existing(const Definition &test, std::string &&filename,
                                  Queries &&q, QueryAnswers &&qa,
-                                 std::vector<std::string> &&rej) {
-  mTests.push_back({test, filename, q, qa, rej});
+                                 std::vector<std::string> &&rej,
+                                 QuerySpecs &&specs) {
+  mTests.push_back({test, filename, q, qa, rej, specs});
+}
+
+Queries Configuration::ExpectedResults::all_queries() const {
+  std::size_t total = queries.size();
+  for (const auto &spec : querySpecs) {
+    total += spec.size();
+  }
+
+  Queries all;
+  all.reserve(total);
+  all.insert(all.end(), queries.begin(), queries.end());
+  for (const auto &spec : querySpecs) {
+    spec.expand(all);
+  }
+  return all;
+}
+
+QueryAnswers Configuration::ExpectedResults::all_expected() const {
+  if (querySpecs.empty())
+    return expected;
+
+  Queries specQueries;
+  for (const auto &spec : querySpecs) {
+    spec.expand(specQueries);
+  }
+
+  QueryAnswers all;
+  all.reserve(expected.size() + specQueries.size());
+  all.insert(all.end(), expected.begin(), expected.end());
+  for (const auto &q : specQueries) {
+    if (auto answer = test.expected_answer(q); answer) {
+      all.push_back(answer.value());
+    }
+  }
+  return all;
 }
 
 void Configuration::write_all_tests(std::filesystem::path locationToWrite,
@@ -115,8 +184,8 @@ void Configuration::write_all_tests(std::filesystem::path locationToWrite,
   });
 }
 
-Configuration Configuration::generate_default(bool noErrors,
-                                              bool generateHuge) {
+Configuration Configuration::generate_default(bool noErrors, bool generateHuge,
+                                              bool generateSweep) {
 
   Configuration config;
 
@@ -128,6 +197,18 @@ Configuration Configuration::generate_default(bool noErrors,
     config.create_new_test(test, 5, 2);
   }
 
+  // Structured sweeps are stored as query specs so they stay small on disk
+  if (generateSweep) {
+    Definition sweep{"Sweep Test", 200, 200,
+                     RowColDataGeneration::IncrementFromPos};
+    config.create_new_test(sweep,
+                           {QuerySpec::full_row(sweep, 0),
+                            QuerySpec::full_col(sweep, 199),
+                            QuerySpec::diagonal(sweep),
+                            QuerySpec::range({50, 50}, {150, 150}, 10)},
+                           2);
+  }
+
   if (generateHuge) {
     Definition huge{"Huge Test - Negative numbers", Definition::HugeSize,
                     Definition::HugeSize,
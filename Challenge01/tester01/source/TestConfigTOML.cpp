@@ -4,7 +4,9 @@
 
 namespace Tests {
 
-const std::string_view Config_File_Version = "1.0";
+const std::string_view Config_File_Version = "1.1";
+// Files written before query specs existed are still readable
+const std::string_view Config_File_Version_NoSpecs = "1.0";
 
 void insert_test(toml::array &root,
                  const Configuration::ExpectedResults &result) {
@@ -19,13 +21,32 @@ void insert_test(toml::array &root,
   r.insert("isHuge", result.test.huge());
   r.insert("hasRandomWhiteSpace", result.test.mInjectRandomWhiteSpace);
 
+  // Formatted into one buffer rather than a string per query
+  char buffer[RowCol::max_colrow_chars];
+  auto colrow = [&buffer](const RowCol &rc) {
+    return std::string_view(
+        buffer, rc.to_colrow_chars(buffer, buffer + sizeof(buffer)).ptr);
+  };
+
   toml::array queries{};
   for (const auto &q : result.queries) {
-    queries.push_back(q.as_colrow_fmt());
+    queries.push_back(colrow(q));
   }
 
   r.insert("queries", queries);
 
+  toml::array querySpecs{};
+  for (const auto &spec : result.querySpecs) {
+    toml::table tb;
+    tb.insert("pattern", QuerySpec::pattern_name(spec.pattern));
+    tb.insert("first", colrow(spec.first));
+    tb.insert("last", colrow(spec.last));
+    tb.insert("stride", spec.stride);
+    querySpecs.push_back(tb);
+  }
+
+  r.insert("querySpecs", querySpecs);
+
   toml::array rejected{};
   for (const auto &rej : result.rejected) {
     rejected.push_back(rej);
@@ -43,7 +64,7 @@ void insert_test(toml::array &root,
     else
       tb.insert("answer", exp.answer);
 
-    tb.insert("query", exp.pos.as_colrow_fmt());
+    tb.insert("query", colrow(exp.pos));
 
     expected.push_back(tb);
   }
@@ -83,6 +104,31 @@ Queries parse_queries(toml::array const &queries) {
   return q;
 }
 
+QuerySpecs parse_query_specs(toml::array const &arr) {
+  QuerySpecs specs;
+  for (auto const &it : arr) {
+    if (!it.is_table())
+      continue;
+
+    auto const &tb = *it.as_table();
+    auto pattern = QuerySpec::pattern_from_name(
+        tb["pattern"].value_or<std::string_view>(""));
+    if (!pattern)
+      continue;
+
+    QuerySpec spec{};
+    spec.pattern = pattern.value();
+    spec.first = RowCol::from_string(tb["first"].value_or<std::string_view>("0,0"));
+    spec.last = RowCol::from_string(tb["last"].value_or<std::string_view>("0,0"));
+    spec.stride = tb["stride"].value_or<std::uint16_t>(1);
+    if (spec.stride == 0)
+      continue;
+
+    specs.push_back(spec);
+  }
+  return specs;
+}
+
 std::vector<std::string> parse_rejected(toml::array const &arr) {
   std::vector<std::string> data;
 
@@ -143,6 +189,7 @@ Configuration parse_tests(toml::array const *arr) {
     std::vector<std::string> rejected;
     QueryAnswers answers;
     Queries queries;
+    QuerySpecs specs;
 
     {
       // Parse query
@@ -152,6 +199,14 @@ Configuration parse_tests(toml::array const *arr) {
       }
     }
 
+    {
+      // Parse query specs, expanded when the test is run
+      auto temp = table["querySpecs"].as_array();
+      if (temp) {
+        specs = parse_query_specs(*temp);
+      }
+    }
+
     {
       // Parse rejected
       auto temp = table["rejected"].as_array();
@@ -168,7 +223,8 @@ Configuration parse_tests(toml::array const *arr) {
     }
 
     config.add_existing(t, std::move(filename), std::move(queries),
-                        std::move(answers), std::move(rejected));
+                        std::move(answers), std::move(rejected),
+                        std::move(specs));
   }
 
   return config;
@@ -184,7 +240,8 @@ Configuration toml_file_to_config(std::filesystem::path filename) {
     return Configuration{};
   }
 
-  if (result["version"] != Config_File_Version) {
+  if (result["version"] != Config_File_Version &&
+      result["version"] != Config_File_Version_NoSpecs) {
     std::cout << "Invalid file configuration version." << '\n';
     return Configuration{};
   }
@@ -35,6 +35,31 @@ QueryAnswers Definition::generate(std::ostream &file,
   return write_data_value(file, guesses);
 };
 
+std::optional<QueryAnswer> Definition::expected_answer(RowCol pos) const {
+  if (pos.row >= mNbrRows || pos.col >= mNbrCols)
+    return QueryAnswer{true, pos, 0};
+
+  if (mError != Errors::None || mData == RowColDataGeneration::Random)
+    return {};
+
+  // Mirrors write_data_value: every cell increments the last value once before
+  // it is written and the value wraps from int16 max back to 0.
+  constexpr std::int64_t max = std::numeric_limits<std::int16_t>::max();
+  const std::int64_t start = mData == RowColDataGeneration::IncrementFromPos
+                                 ? 0
+                                 : std::numeric_limits<std::int16_t>::min();
+  const std::uint64_t steps =
+      std::uint64_t{pos.row} * mNbrCols + std::uint64_t{pos.col} + 1;
+  const std::uint64_t stepsToMax = static_cast<std::uint64_t>(max - start);
+
+  if (steps <= stepsToMax)
+    return QueryAnswer{false, pos,
+                       static_cast<std::int16_t>(start + static_cast<std::int64_t>(steps))};
+
+  const auto wrapped = (steps - stepsToMax - 1) % static_cast<std::uint64_t>(max + 1);
+  return QueryAnswer{false, pos, static_cast<std::int16_t>(wrapped)};
+}
+
 std::string Definition::make_row_value(std::size_t value, Errors err) const {
   // std::stringbuf sb;
   std::stringstream ss;
@@ -1,53 +1,61 @@
 #include "base26.hpp"
 #include "stringutil.hpp"
 #include <algorithm>
-#include <cmath>
+#include <array>
 #include <ranges>
 #include <string>
 
 namespace base26
 {
 
-constexpr std::size_t reserve_amount(int value)
-{
-    if (value < 26)
-        return 1;
-    if (value >= 26 && value <= 9999999)
-        return 6;
+constexpr std::array<char, 26> digits{'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm',
+                                      'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z'};
+
+constexpr std::array<int, max_chars> powers{1, 26, 676, 17576, 456976, 11881376, 308915776};
 
-    return 8;
+constexpr std::size_t letter_count(int value)
+{
+    std::size_t count = 1;
+    while (count < powers.size() && value >= powers[count])
+        ++count;
+    return count;
 }
 
-std::string to(int value)
+std::to_chars_result to_chars(char *first, char *last, int value)
 {
-    if (value == 0)
-    {
-        return "a";
-    }
+    if (value < 0)
+        return {last, std::errc::invalid_argument};
 
-    std::string result{};
-    result.reserve(reserve_amount(value));
+    const std::size_t count = letter_count(value);
+    if (static_cast<std::size_t>(last - first) < count)
+        return {last, std::errc::value_too_large};
 
-    while (value > 0)
+    // Fill from the least significant letter backwards so no reverse is needed
+    char *pos = first + count;
+    do
     {
-        auto out = std::div(value, 26);
-        result += static_cast<char>('a' + out.rem);
-        value = out.quot;
-    }
+        *--pos = digits[static_cast<std::size_t>(value % 26)];
+        value /= 26;
+    } while (pos != first);
 
-    std::ranges::reverse(result);
-    return result;
+    return {first + count, std::errc{}};
 }
 
-int from(std::string_view const letters)
+std::string to(int value)
 {
+    char buffer[max_chars];
+    auto result = to_chars(buffer, buffer + max_chars, value);
+    if (result.ec != std::errc{})
+        return {};
+    return std::string(buffer, result.ptr);
+}
 
-    std::size_t numberLetters = letters.size();
+int from(std::string_view const letters)
+{
     int value = 0;
     for (auto l : letters | std::views::transform(util::toLower))
     {
-        value += (l - 'a') * static_cast<int>(std::pow(26, numberLetters - 1));
-        --numberLetters;
+        value = value * 26 + (l - 'a');
     }
     return value;
 }
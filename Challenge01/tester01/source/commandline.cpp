@@ -51,7 +51,10 @@ std::optional<Options> parse(int argc, char *argv[]) {
             "files." |
         option("--all").set(opt.tests, TestModes::All) %
             "Generate all test files this is the default."),
-       option("--huge").set(opt.huge) % "Generate a huge test file.");
+       option("--huge").set(opt.huge) % "Generate a huge test file.",
+       option("--sweep").set(opt.sweep) %
+           "Generate a 200x200 test queried by rows, columns, diagonal and "
+           "ranges.");
 
   auto cli = (commandRun | commandGenerate |
                   command("help").set(opt.mode, RunMode::Help),
@@ -6,7 +6,7 @@
 
 int generate_tests_cmd_line(std::filesystem::path test_output,
                             CommandLine::TestModes mode, bool huge,
-                            bool overwrite) {
+                            bool overwrite, bool sweep) {
   if (overwrite) {
     std::cout << "Overwriting existing file..." << '\n';
   }
@@ -16,7 +16,7 @@ int generate_tests_cmd_line(std::filesystem::path test_output,
 
   bool noErrors = mode == CommandLine::TestModes::NoErrors;
   Tests::Configuration config{
-      Tests::Configuration::generate_default(noErrors, huge)};
+      Tests::Configuration::generate_default(noErrors, huge, sweep)};
 
   config.write_all_tests(std::filesystem::current_path(), false);
 
@@ -75,7 +75,8 @@ int main(int argc, char *argv[])
     {
     case CommandLine::RunMode::Generate:
         std::cout << opt.testFile << '\n';
-        return generate_tests_cmd_line(opt.testFile, opt.tests, opt.huge, opt.overwrite);
+        return generate_tests_cmd_line(opt.testFile, opt.tests, opt.huge, opt.overwrite,
+                                       opt.sweep);
 
     case CommandLine::RunMode::Run:
         return main_run_tests(opt.testFile, opt.testProgram);
@@ -1,4 +1,5 @@
 #include "runtests.hpp"
+#include "RowColArena.hpp"
 #include "TestConfigTOML.hpp"
 #include "TestDefinition.hpp"
 #include "stringutil.hpp"
@@ -7,7 +8,6 @@
 #include <chrono>
 #include <commandline.hpp>
 #include <iostream>
-#include <numeric>
 #include <ranges>
 #include <reproc++/drain.hpp>
 #include <reproc++/reproc.hpp>
@@ -131,7 +131,7 @@ struct ExecuteResult
     std::vector<AppLogEntry> logs;
 };
 
-ExecuteResult execute_app(const std::vector<std::string> &arguments)
+ExecuteResult execute_app(const char *const *arguments)
 {
     reproc::stop_actions stopActions{{reproc::stop::kill, 5000ms}, {reproc::stop::terminate, 10000ms}, {}};
 
@@ -284,9 +284,10 @@ bool program_output_pass(const Tests::Configuration::ExpectedResults &expected,
 
     // Look for the answers now
     // Generate answers to search for
+    const Tests::QueryAnswers expectedAnswers = expected.all_expected();
     std::vector<std::string> answers;
-    answers.reserve(expected.expected.size());
-    std::transform(expected.expected.begin(), expected.expected.end(), std::back_inserter(answers),
+    answers.reserve(expectedAnswers.size());
+    std::transform(expectedAnswers.begin(), expectedAnswers.end(), std::back_inserter(answers),
                    [](const Tests::QueryAnswer &q) {
                        if (q.is_oob)
                            return std::string("oob");
@@ -320,23 +321,31 @@ TestResult run_test(const Tests::Configuration::ExpectedResults &expected, std::
 {
 
     TestResult result(expected.test);
-    std::vector<std::string> cmdVector{app, "--load", expected.filename, "--guess"};
+    const Tests::Queries queries = expected.all_queries();
+    const RowColArena guesses{queries, RowColArena::Format::Base26};
 
-    for (auto &guess : expected.queries)
+    std::vector<const char *> argv{app.c_str(), "--load", expected.filename.c_str(), "--guess"};
+    argv.reserve(argv.size() + guesses.size() + 2);
+    for (std::size_t i = 0; i < guesses.size(); ++i)
     {
-        cmdVector.push_back(guess.as_base26_fmt());
+        argv.push_back(guesses.c_str(i));
     }
-    if (expected.queries.size() == 0)
+    if (guesses.size() == 0)
     {
-        cmdVector.push_back("a0");
+        argv.push_back("a0");
     }
 
-    result.cmdline = std::accumulate(std::next(cmdVector.begin()), cmdVector.end(), cmdVector[0],
-                                     [](std::string a, std::string &b) { return std::move(a) + ' ' + b; });
+    for (const char *arg : argv)
+    {
+        if (!result.cmdline.empty())
+            result.cmdline += ' ';
+        result.cmdline += arg;
+    }
+    argv.push_back(nullptr);
 
     std::cout << "Running test: " << result.cmdline << '\n';
     auto start = std::chrono::high_resolution_clock::now();
-    auto ret = execute_app(cmdVector);
+    auto ret = execute_app(argv.data());
     auto end = std::chrono::high_resolution_clock::now();
 
     result.timeToRun = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
@@ -0,0 +1,80 @@
+// Times VirtualGames::guess, the path every answer of an AI goes through,
+// on one board of each BoardState size class. Every game shoots the cells
+// in the same shuffled order until all the ships are sunk. Larger boards
+// play fewer games, about as many guesses as the 10x10 games.
+//
+//   guess_bench [10x10 games]
+
+#include "virtualgames.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Board {
+  char const *name;
+  std::uint16_t rows;
+  std::uint16_t cols;
+  std::uint16_t largest;
+};
+
+// Fixed 128 and 256 bit states, the dynamic one and the sparse one
+constexpr Board boards[] = {{"10x10", 10, 10, 5},
+                            {"15x15", 15, 15, 5},
+                            {"100x100", 100, 100, 40},
+                            {"300x300", 300, 300, 40}};
+
+battleship::GameLayout layout_of(Board const &board) {
+  return battleship::GameLayout{
+      battleship::ShipDefinition{2}, battleship::ShipDefinition{board.largest},
+      battleship::Row{board.rows}, battleship::Col{board.cols}};
+}
+
+// Nanoseconds per guess, sunk_all_ships() included as the runners call it
+double time_guesses(Board const &board, std::size_t games) {
+  std::vector<battleship::RowCol> cells(std::size_t{board.rows} * board.cols);
+  for (std::size_t cell = 0; cell < cells.size(); ++cell)
+    cells[cell] = battleship::RowCol{
+        battleship::Row{static_cast<std::uint16_t>(cell / board.cols)},
+        battleship::Col{static_cast<std::uint16_t>(cell % board.cols)}};
+  std::ranges::shuffle(cells, std::mt19937_64{42});
+
+  games = std::max<std::size_t>(1, games * 100 / cells.size());
+  VirtualGames game("guess_bench", 0, layout_of(board), true);
+  std::size_t guesses{0};
+  Clock::duration spent{};
+  for (std::size_t played = 0; played < games; ++played) {
+    game.new_game();
+    auto const start = Clock::now();
+    for (auto const &cell : cells) {
+      game.guess(cell);
+      ++guesses;
+      if (game.sunk_all_ships())
+        break;
+    }
+    spent += Clock::now() - start;
+    game.end_game(VirtualGames::EndingState::sunk_all_ships);
+  }
+  return std::chrono::duration<double, std::nano>(spent).count() /
+         static_cast<double>(guesses);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::size_t const games =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+  if (games == 0)
+    return 1;
+
+  std::printf("%zu games, ns per guess\n", games);
+  for (auto const &board : boards)
+    std::printf("  %-10s %8.1f\n", board.name, time_guesses(board, games));
+  return 0;
+}
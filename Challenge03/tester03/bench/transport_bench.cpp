@@ -0,0 +1,136 @@
+// Ping-pong between the tester and a forked echo process, one reply and one
+// guess per round trip, over a pair of pipes and over the shared memory
+// rings of shmring.hpp.
+//
+//   transport_bench [round trips]
+
+#include "shmring.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::string_view reply{"M\n"};
+constexpr std::string_view guess{"a1\n"};
+
+struct Timing {
+  double median_ns;
+  double p99_ns;
+};
+
+Timing summarize(std::vector<Clock::duration> &trips) {
+  std::ranges::sort(trips);
+  auto ns = [](Clock::duration trip) {
+    return std::chrono::duration<double, std::nano>(trip).count();
+  };
+  return {ns(trips[trips.size() / 2]), ns(trips[trips.size() * 99 / 100])};
+}
+
+// Reads until a whole line arrived, false once the other side is gone
+bool read_line(int fd) {
+  char buffer[64];
+  while (true) {
+    auto const bytes = ::read(fd, buffer, sizeof(buffer));
+    if (bytes <= 0)
+      return false;
+    if (buffer[bytes - 1] == '\n')
+      return true;
+  }
+}
+
+bool read_line(shm::Ring &ring) {
+  char buffer[64];
+  while (ring.wait_readable(std::chrono::seconds(5))) {
+    auto const bytes = ring.read(buffer, sizeof(buffer));
+    if (bytes > 0 && buffer[bytes - 1] == '\n')
+      return true;
+  }
+  return false;
+}
+
+Timing pipes(std::size_t trips) {
+  int to_ai[2];
+  int from_ai[2];
+  if (::pipe(to_ai) != 0 || ::pipe(from_ai) != 0)
+    std::exit(1);
+
+  if (::fork() == 0) {
+    ::close(to_ai[1]);
+    ::close(from_ai[0]);
+    while (read_line(to_ai[0]))
+      [[maybe_unused]] auto ignored =
+          ::write(from_ai[1], guess.data(), guess.size());
+    std::_Exit(0);
+  }
+  ::close(to_ai[0]);
+  ::close(from_ai[1]);
+
+  std::vector<Clock::duration> times(trips);
+  for (auto &time : times) {
+    auto const start = Clock::now();
+    [[maybe_unused]] auto ignored =
+        ::write(to_ai[1], reply.data(), reply.size());
+    read_line(from_ai[0]);
+    time = Clock::now() - start;
+  }
+  ::close(to_ai[1]);
+  ::close(from_ai[0]);
+  ::wait(nullptr);
+  return summarize(times);
+}
+
+Timing rings(std::size_t trips) {
+  void *memory = ::mmap(nullptr, sizeof(shm::Channel), PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED)
+    std::exit(1);
+  auto *channel = new (memory) shm::Channel{};
+
+  if (::fork() == 0) {
+    for (std::size_t trip = 0; trip < trips; ++trip) {
+      if (!read_line(channel->to_ai))
+        break;
+      channel->from_ai.write(guess);
+    }
+    std::_Exit(0);
+  }
+
+  std::vector<Clock::duration> times(trips);
+  for (auto &time : times) {
+    auto const start = Clock::now();
+    channel->to_ai.write(reply);
+    read_line(channel->from_ai);
+    time = Clock::now() - start;
+  }
+  ::wait(nullptr);
+  ::munmap(memory, sizeof(shm::Channel));
+  return summarize(times);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::size_t const trips =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+  if (trips == 0)
+    return 1;
+
+  auto const pipe = pipes(trips);
+  auto const ring = rings(trips);
+  std::printf("%zu round trips, ns     median      p99\n", trips);
+  std::printf("  pipes              %8.0f %8.0f\n", pipe.median_ns,
+              pipe.p99_ns);
+  std::printf("  shared memory      %8.0f %8.0f\n", ring.median_ns,
+              ring.p99_ns);
+  return 0;
+}
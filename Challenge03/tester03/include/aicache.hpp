@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+
+/***
+ * @description Remembers the number of AIs of a program, keyed by its path,
+ * size and modification time. The binary is hashed only when those change,
+ * so a rebuilt program is asked again and a touched or copied one is not.
+ * Stored in $XDG_CACHE_HOME/tester03 (or ~/.cache/tester03), one entry per
+ * program.
+ * */
+
+namespace aicache {
+
+std::optional<std::size_t> lookup(std::string const &program);
+void store(std::string const &program, std::size_t nbrAi);
+
+} // namespace aicache
@@ -0,0 +1,50 @@
+#pragma once
+
+/***
+ * @description C ABI for AIs loaded in process by `tester03 run --plugin`.
+ * Build the AI as a shared library exporting every function below.
+ *
+ * Each runner thread creates its own handle with ai_new and only calls it
+ * from that thread, handles must not share mutable state.
+ * */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AI_PLUGIN_ABI_VERSION 1u
+
+typedef struct ai_layout {
+  uint32_t rows;
+  uint32_t cols;
+  uint32_t smallest_ship;
+  uint32_t largest_ship;
+} ai_layout;
+
+typedef struct ai_handle ai_handle;
+
+enum ai_result { AI_MISS = 0, AI_HIT = 1, AI_SINK = 2 };
+
+// Must return AI_PLUGIN_ABI_VERSION
+uint32_t ai_abi_version(void);
+
+// Number of AIs in the library, ids go from 0 to ai_count() - 1
+size_t ai_count(void);
+
+ai_handle *ai_new(size_t id, const ai_layout *layout);
+
+// Writes the next guess. Returns 0 when the AI has no guesses left.
+int ai_guess(ai_handle *ai, uint32_t *row, uint32_t *col);
+
+// Answer to the last guess, ship_size is only set for AI_HIT and AI_SINK
+void ai_feedback(ai_handle *ai, int result, uint32_t ship_size);
+
+void ai_new_game(ai_handle *ai);
+void ai_delete(ai_handle *ai);
+
+#ifdef __cplusplus
+}
+#endif
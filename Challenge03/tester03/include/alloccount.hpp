@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+/***
+ * @description Counts the heap allocations made by the calling thread. Builds
+ * configured with -DTESTER03_COUNT_ALLOCATIONS=ON replace the global operator
+ * new (see alloccount.cpp) to count them, other builds always report 0.
+ *
+ * Answering a valid guess on a dense board (VirtualGames::dense) does not
+ * allocate. Invalid guesses and the shot set of a large board can.
+ * */
+
+namespace alloccount {
+
+std::size_t thread_allocations() noexcept;
+
+// Allocations made by this thread while the scope is alive
+class Scope {
+  std::size_t m_start;
+
+public:
+  Scope() noexcept : m_start(thread_allocations()) {}
+  std::size_t count() const noexcept {
+    return thread_allocations() - m_start;
+  }
+};
+
+} // namespace alloccount
@@ -0,0 +1,224 @@
+#pragma once
+
+#include "shipindex.hpp"
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/***
+ * @description What VirtualGames needs to resolve a guess in constant time:
+ * the cells already shot, the cells of every ship and the number of ships
+ * still afloat. Built once per game from the board kept in
+ * VirtualGames::Game (ship size per cell), the storage is reused between
+ * games.
+ *
+ * Boards of up to 128 or 256 cells (the default 10x10 fits in 128) use
+ * fixed width bitboards, a shot is a few word wide AND and popcount
+ * operations. Larger boards use DynamicBoardState. BoardState picks one at
+ * reset. Boards too large to hold a byte per cell (see
+ * VirtualGames::max_dense_cells) use SparseBoardState, built from the
+ * ShipIndex of the game instead of a board. VirtualGames visits the state
+ * once per game and plays every shot on the concrete type.
+ * */
+
+namespace boardstate {
+
+struct Shot {
+  static constexpr std::size_t no_ship = static_cast<std::size_t>(-1);
+
+  bool repeat{false};
+  std::size_t ship{no_ship}; // Index of the ship hit
+  bool sunk{false};          // The ship hit has no cell left
+};
+
+// No heap storage, the whole state of a 10x10 game is a few cache lines
+template <std::size_t Bits> class FixedBoardState {
+public:
+  static constexpr std::size_t capacity = Bits;
+  static constexpr std::size_t max_ships = 32;
+
+  void reset(std::span<const std::uint8_t> board, std::size_t smallest,
+             std::size_t nbrShips) {
+    m_shots.reset();
+    m_occupied.reset();
+    for (std::size_t ship = 0; ship < nbrShips; ++ship)
+      m_ships[ship].reset();
+    for (std::size_t cell = 0; cell < board.size(); ++cell) {
+      m_ship_of[cell] = board[cell];
+      if (board[cell] == 0)
+        continue;
+      m_ships[board[cell] - smallest][cell] = true;
+      m_occupied[cell] = true;
+    }
+    m_smallest = smallest;
+    m_ships_left = nbrShips;
+  }
+
+  Shot shoot(std::size_t cell) {
+    Shot shot;
+    // operator[] instead of test and set, no range check on the hot path
+    shot.repeat = m_shots[cell];
+    m_shots[cell] = true;
+    if (!m_occupied[cell])
+      return shot;
+
+    shot.ship = m_ship_of[cell] - m_smallest;
+    auto const &ship = m_ships[shot.ship];
+    shot.sunk = (ship & m_shots) == ship;
+    if (shot.sunk && !shot.repeat)
+      --m_ships_left;
+    return shot;
+  }
+
+  bool all_sunk() const noexcept { return m_ships_left == 0; }
+
+private:
+  std::bitset<Bits> m_shots;
+  std::bitset<Bits> m_occupied;
+  std::array<std::bitset<Bits>, max_ships> m_ships{}; // Cells of each ship
+  std::array<std::uint8_t, Bits> m_ship_of{};         // Ship size per cell
+  std::size_t m_smallest{0};
+  std::size_t m_ships_left{0};
+};
+
+// Any board size, one bit per cell and a hit count per ship
+class DynamicBoardState {
+public:
+  void reset(std::span<const std::uint8_t> board, std::size_t smallest,
+             std::size_t nbrShips) {
+    m_shots.assign((board.size() + 63) / 64, 0);
+    m_ship_of.assign(board.begin(), board.end());
+    m_hits.assign(nbrShips, 0);
+    m_sizes.assign(nbrShips, 0);
+    for (auto const size : board) {
+      if (size != 0)
+        ++m_sizes[size - smallest];
+    }
+    m_smallest = smallest;
+    m_ships_left = nbrShips;
+  }
+
+  Shot shoot(std::size_t cell) {
+    Shot shot;
+    auto &word = m_shots[cell / 64];
+    auto const bit = std::uint64_t{1} << (cell % 64);
+    shot.repeat = (word & bit) != 0;
+    word |= bit;
+    if (m_ship_of[cell] == 0)
+      return shot;
+
+    shot.ship = m_ship_of[cell] - m_smallest;
+    if (!shot.repeat && ++m_hits[shot.ship] == m_sizes[shot.ship])
+      --m_ships_left;
+    shot.sunk = m_hits[shot.ship] == m_sizes[shot.ship];
+    return shot;
+  }
+
+  bool all_sunk() const noexcept { return m_ships_left == 0; }
+
+private:
+  std::vector<std::uint64_t> m_shots;
+  std::vector<std::uint8_t> m_ship_of;
+  std::vector<std::size_t> m_hits;
+  std::vector<std::size_t> m_sizes;
+  std::size_t m_smallest{0};
+  std::size_t m_ships_left{0};
+};
+
+// Any board size, memory grows with the guesses instead of the board: the
+// cells shot in a hash set, the ships looked up in the ShipIndex and a hit
+// count per ship
+class SparseBoardState {
+public:
+  // ships must outlive the game, nbrSizes is the number of ship sizes
+  void reset(ShipIndex const &ships, std::size_t cols, std::size_t smallest,
+             std::size_t nbrSizes) {
+    m_ships = &ships;
+    m_cols = cols;
+    m_shots.clear(); // Keeps its buckets for the next game
+    m_hits.assign(nbrSizes, 0);
+    m_smallest = smallest;
+    m_ships_left = ships.size();
+  }
+
+  Shot shoot(std::size_t cell) {
+    Shot shot;
+    shot.repeat = !m_shots.insert(cell).second;
+    auto const *ship = m_ships->find(cell / m_cols, cell % m_cols);
+    if (!ship || ship->size < m_smallest ||
+        ship->size - m_smallest >= m_hits.size())
+      return shot;
+
+    shot.ship = ship->size - m_smallest;
+    if (!shot.repeat && ++m_hits[shot.ship] == ship->size)
+      --m_ships_left;
+    shot.sunk = m_hits[shot.ship] == ship->size;
+    return shot;
+  }
+
+  bool all_sunk() const noexcept { return m_ships_left == 0; }
+
+private:
+  ShipIndex const *m_ships{nullptr};
+  std::size_t m_cols{1};
+  std::unordered_set<std::uint64_t> m_shots;
+  std::vector<std::size_t> m_hits;
+  std::size_t m_smallest{0};
+  std::size_t m_ships_left{0};
+};
+
+} // namespace boardstate
+
+class BoardState {
+public:
+  // board holds the ship size on each cell, 0 for water
+  void reset(std::span<const std::uint8_t> board, std::size_t smallest,
+             std::size_t nbrShips) {
+    bool const few_ships =
+        nbrShips <= boardstate::FixedBoardState<128>::max_ships;
+    if (few_ships && board.size() <= boardstate::FixedBoardState<128>::capacity)
+      use<boardstate::FixedBoardState<128>>().reset(board, smallest, nbrShips);
+    else if (few_ships &&
+             board.size() <= boardstate::FixedBoardState<256>::capacity)
+      use<boardstate::FixedBoardState<256>>().reset(board, smallest, nbrShips);
+    else
+      use<boardstate::DynamicBoardState>().reset(board, smallest, nbrShips);
+  }
+
+  // Boards without a byte per cell, see SparseBoardState
+  void reset(ShipIndex const &ships, std::size_t cols, std::size_t smallest,
+             std::size_t nbrSizes) {
+    use<boardstate::SparseBoardState>().reset(ships, cols, smallest, nbrSizes);
+  }
+
+  // Calls f with the state reset last. Meant to be called once per game,
+  // f picks code specialised on the state so the shots need no dispatch.
+  template <class F> decltype(auto) visit(F &&f) {
+    return std::visit(std::forward<F>(f), m_state);
+  }
+
+  // The state reset last, State must be the one visit passed
+  template <class State> State &get() noexcept {
+    return *std::get_if<State>(&m_state);
+  }
+
+private:
+  // Keeps the storage when the size class does not change between games
+  template <class State> State &use() {
+    if (!std::holds_alternative<State>(m_state))
+      m_state.template emplace<State>();
+    return std::get<State>(m_state);
+  }
+
+  std::variant<boardstate::FixedBoardState<128>,
+               boardstate::FixedBoardState<256>,
+               boardstate::DynamicBoardState,
+               boardstate::SparseBoardState>
+      m_state;
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+
+/***
+ * @description Pairs of logical CPUs close enough that a runner thread and
+ * the AI process it drives can ping-pong without crossing cores or sockets.
+ * Read from /sys/devices/system/cpu.
+ * */
+
+namespace cputopology {
+
+struct CpuPair {
+  int runner_cpu;
+  int ai_cpu;
+};
+
+// SMT siblings first, then CPUs sharing an L2 cache, then whatever is left
+// in order. Empty when the topology cannot be read.
+std::vector<CpuPair> sibling_pairs();
+
+bool pin_current_thread(int cpu);
+bool pin_process(int pid, int cpu);
+
+} // namespace cputopology
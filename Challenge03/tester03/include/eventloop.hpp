@@ -0,0 +1,53 @@
+#pragma once
+
+#include "aistats.hpp"
+#include "cputopology.hpp"
+#include "programoptions.hpp"
+#include "virtualgames.hpp"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/***
+ * @description Alternative to one TestRunner thread per AI process. A few
+ * event loop threads drive every AI process through non-blocking pipes and
+ * epoll. Each running game is a small state machine (see Session in
+ * eventloop.cpp) that follows the same steps as TestRunner.
+ *
+ * */
+
+class EventLoopRunner {
+public:
+  struct Shard {
+    AIID aiid;
+    std::size_t iterations;
+  };
+
+  EventLoopRunner(ProgramOptions::Options const &options,
+                  std::vector<Shard> const &shards);
+  ~EventLoopRunner();
+
+  EventLoopRunner(const EventLoopRunner &) = delete;
+  EventLoopRunner &operator=(const EventLoopRunner &) = delete;
+
+  // Blocks until every shard has played all of its games
+  void run(std::size_t nbrLoops);
+
+  // Each loop thread and the AI processes it drives share a pair of nearby
+  // CPUs. Call before run.
+  void pin_to(std::vector<cputopology::CpuPair> pairs);
+
+  std::size_t size() const noexcept { return m_sessions.size(); }
+  std::size_t current_round(std::size_t shard) const noexcept;
+  bool is_completed(std::size_t shard) const noexcept;
+  const VirtualGames &games(std::size_t shard) const;
+
+private:
+  struct Session;
+
+  void run_loop(std::size_t loop, std::size_t nbrLoops);
+  void reap_all();
+
+  std::vector<std::unique_ptr<Session>> m_sessions;
+  std::vector<cputopology::CpuPair> m_cpus;
+};
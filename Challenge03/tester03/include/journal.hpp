@@ -0,0 +1,48 @@
+#pragma once
+
+#include "virtualgames.hpp"
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+/***
+ * @description Result file of one shard of a run (`run --shard i/N`). Holds
+ * every game with its ships, guesses and per game counters, as text, so
+ * `tester03 merge` rebuilds the same VirtualGames the shard had and merges
+ * the shards exactly. A --stats-only shard has no ships and no moves, its
+ * games are rebuilt from the totals.
+ *
+ * Layout, one record per line:
+ *   tester03-journal 1
+ *   shard {index} {count}
+ *   layout {rows} {cols} {smallest ship} {largest ship}
+ *   ai {id} {restarts} {restart us} {longest restart us} {program}
+ *   game {ending} {invalid} {repeat} {early} {allocations} {turns}
+ *        {timed budget} {budget left us} {guesses} {total us}
+ *        {shortest us} {longest us} {answer mean us} {answer m2}
+ *        {ships} ({row} {col} {size} {across})...
+ *   moves {count} ({row} {col} {elapsed us} {result})...
+ *   latency {phase} {min us} {max us} {count} ({bucket} {answers})...
+ *   harness {answers} {mean us} {m2}
+ *   end
+ * A ship is its first cell, its size and 1 when it lies along a row, the
+ * same on any board size. A latency line holds the non empty buckets of the
+ * answer time histogram of one phase of the AI, the harness line the echo_ai
+ * answer times of run --baseline.
+ * */
+
+namespace journal {
+
+struct Shard {
+  std::size_t index{0};
+  std::size_t count{1};
+  std::vector<VirtualGames> games; // One per AI
+};
+
+bool write(std::string const &path, std::size_t shard_index,
+           std::size_t shard_count, std::vector<VirtualGames> const &games);
+
+std::optional<Shard> read(std::string const &path);
+
+} // namespace journal
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+/***
+ * @description Histogram of answer times in the style of HdrHistogram. Below
+ * 32 us there is one bucket per microsecond. Above that every power of two
+ * is split into 32 linear sub buckets, so a bucket is never more than 1/32
+ * (about 3%) of its lower bound wide. Memory is fixed (1056 counters, up to
+ * 2^37 us, larger times land in the last bucket), recording is a bit_width
+ * and an increment, and two histograms merge by adding their counters.
+ * */
+class LatencyHistogram {
+public:
+  using TimeT = std::chrono::microseconds;
+
+  static constexpr unsigned sub_bits = 5;
+  static constexpr std::size_t sub_count = std::size_t{1} << sub_bits;
+  static constexpr unsigned max_exponent = 36;
+  static constexpr std::size_t bucket_count =
+      sub_count + (max_exponent - sub_bits + 1) * sub_count;
+
+  static constexpr std::size_t bucket_of(std::uint64_t micros) noexcept {
+    if (micros < sub_count)
+      return static_cast<std::size_t>(micros);
+    auto const exponent = static_cast<unsigned>(std::bit_width(micros)) - 1;
+    if (exponent > max_exponent)
+      return bucket_count - 1;
+    auto const shift = exponent - sub_bits;
+    return sub_count + shift * sub_count +
+           static_cast<std::size_t>((micros >> shift) - sub_count);
+  }
+
+  // Smallest time counted in bucket
+  static constexpr std::uint64_t lower_bound(std::size_t bucket) noexcept {
+    if (bucket < sub_count)
+      return bucket;
+    auto const shift = (bucket - sub_count) / sub_count;
+    auto const sub = (bucket - sub_count) % sub_count;
+    return std::uint64_t{sub_count + sub} << shift;
+  }
+
+  // Largest time counted in bucket
+  static constexpr std::uint64_t upper_bound(std::size_t bucket) noexcept {
+    return bucket + 1 < bucket_count ? lower_bound(bucket + 1) - 1
+                                     : UINT64_MAX;
+  }
+
+  void record(TimeT elapsed) noexcept {
+    auto const micros =
+        static_cast<std::uint64_t>(std::max<TimeT::rep>(0, elapsed.count()));
+    ++m_counts[bucket_of(micros)];
+    ++m_total;
+    m_min = std::min(m_min, micros);
+    m_max = std::max(m_max, micros);
+  }
+
+  LatencyHistogram &operator+=(LatencyHistogram const &other) noexcept {
+    std::transform(m_counts.begin(), m_counts.end(), other.m_counts.begin(),
+                   m_counts.begin(), std::plus{});
+    m_total += other.m_total;
+    m_min = std::min(m_min, other.m_min);
+    m_max = std::max(m_max, other.m_max);
+    return *this;
+  }
+
+  // Rebuilds a histogram written out bucket by bucket, see journal.hpp
+  void add_count(std::size_t bucket, std::uint64_t count, TimeT min,
+                 TimeT max) noexcept {
+    if (bucket >= bucket_count || count == 0)
+      return;
+    m_counts[bucket] += count;
+    m_total += count;
+    m_min = std::min(m_min, static_cast<std::uint64_t>(min.count()));
+    m_max = std::max(m_max, static_cast<std::uint64_t>(max.count()));
+  }
+
+  // Highest time of the bucket holding the q-th quantile (0 < q <= 1),
+  // within the smallest and largest time recorded
+  TimeT percentile(double q) const noexcept {
+    if (m_total == 0)
+      return TimeT{0};
+    auto const rank = std::clamp<std::uint64_t>(
+        static_cast<std::uint64_t>(std::ceil(q * static_cast<double>(m_total))),
+        1, m_total);
+    std::uint64_t seen{0};
+    std::size_t bucket{0};
+    for (; bucket < bucket_count; ++bucket) {
+      seen += m_counts[bucket];
+      if (seen >= rank)
+        break;
+    }
+    auto const value = std::clamp(upper_bound(bucket), m_min, m_max);
+    return TimeT{static_cast<TimeT::rep>(value)};
+  }
+
+  std::uint64_t count() const noexcept { return m_total; }
+  std::uint64_t count(std::size_t bucket) const noexcept {
+    return m_counts[bucket];
+  }
+  TimeT min() const noexcept {
+    return TimeT{m_total ? static_cast<TimeT::rep>(m_min) : 0};
+  }
+  TimeT max() const noexcept { return TimeT{static_cast<TimeT::rep>(m_max)}; }
+
+private:
+  std::array<std::uint64_t, bucket_count> m_counts{};
+  std::uint64_t m_total{0};
+  std::uint64_t m_min{UINT64_MAX};
+  std::uint64_t m_max{0};
+};
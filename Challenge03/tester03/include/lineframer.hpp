@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string_view>
+
+/***
+ * @description Splits the output of an AI into lines. Bytes are kept in a
+ * fixed ring buffer so a partial line waits for the rest of it and extra
+ * lines that arrive early wait for their turn.
+ *
+ * Usage: read into write_area(), call commit() with the number of bytes read,
+ * then take lines with next_line().
+ *
+ * Game boundaries: start_game() drops every line buffered so far. An AI
+ * started with --line-per-reply answers every reply (E, M, H, S) with exactly
+ * one line, the framer counts the lines it still owes and drops those of the
+ * previous game as they arrive. Other AIs may stop writing once their last
+ * ship sinks, the runner drains what they already wrote before start_game().
+ * */
+
+class LineFramer {
+public:
+  static constexpr std::size_t capacity = 1024; // Must be a power of two
+
+  // Contiguous free space to read into. Can be smaller than the free space
+  // when the ring wraps, read again after commit() to get the rest.
+  std::span<char> write_area() noexcept {
+    const std::size_t start = m_tail & mask;
+    const std::size_t free = capacity - size();
+    return {m_ring.data() + start, std::min(free, capacity - start)};
+  }
+
+  void commit(std::size_t bytes) noexcept {
+    for (std::size_t pos = m_tail; pos < m_tail + bytes; ++pos) {
+      if (m_ring[pos & mask] == '\n')
+        ++m_lines;
+    }
+    m_tail += bytes;
+    drop_stale_lines();
+  }
+
+  // The AI answers every reply with one line, see --line-per-reply
+  void set_line_per_reply(bool counted) noexcept {
+    m_line_per_reply = counted;
+  }
+  constexpr bool line_per_reply() const noexcept { return m_line_per_reply; }
+
+  // A reply was sent, the AI owes one line for it
+  void reply_sent() noexcept { ++m_owed; }
+
+  // Everything received so far, and every line still owed by an AI that
+  // answers every reply, was sent before the new game began
+  void start_game() noexcept {
+    while (m_lines > 0) {
+      skip_line();
+      if (m_owed > 0)
+        --m_owed;
+    }
+    if (m_line_per_reply)
+      m_stale += m_owed;
+    m_owed = 0;
+
+    // A partial line is the start of a stale one, even from an AI that sent
+    // more than it owed
+    if (size() > 0 && m_stale == 0)
+      m_stale = 1;
+  }
+
+  // The next complete line without its '\n' (or "\r\n"). The view is only
+  // valid until the next call to any non const method.
+  std::optional<std::string_view> next_line() noexcept {
+    if (m_lines == 0)
+      return {};
+
+    std::size_t length = 0;
+    while (m_ring[(m_head + length) & mask] != '\n') {
+      m_line[length] = m_ring[(m_head + length) & mask];
+      ++length;
+    }
+    m_head += length + 1;
+    --m_lines;
+    if (m_owed > 0)
+      --m_owed;
+
+    if (length > 0 && m_line[length - 1] == '\r')
+      --length;
+    return std::string_view{m_line.data(), length};
+  }
+
+  constexpr std::size_t pending_lines() const noexcept { return m_lines; }
+  constexpr std::size_t stale_lines() const noexcept { return m_stale; }
+  constexpr bool has_line() const noexcept { return m_lines > 0; }
+  constexpr std::size_t size() const noexcept { return m_tail - m_head; }
+
+  // Full of bytes without a single line, the AI is not following the protocol
+  constexpr bool full() const noexcept { return size() == capacity; }
+
+  void clear() noexcept {
+    m_head = m_tail = 0;
+    m_lines = 0;
+    m_owed = 0;
+    m_stale = 0;
+  }
+
+private:
+  void skip_line() noexcept {
+    while (m_ring[m_head & mask] != '\n')
+      ++m_head;
+    ++m_head;
+    --m_lines;
+  }
+
+  void drop_stale_lines() noexcept {
+    while (m_stale > 0 && m_lines > 0) {
+      skip_line();
+      --m_stale;
+    }
+  }
+
+  static constexpr std::size_t mask = capacity - 1;
+  static_assert((capacity & mask) == 0);
+
+  std::array<char, capacity> m_ring{};
+  std::array<char, capacity> m_line{};
+  std::size_t m_head{0}; // Total bytes consumed
+  std::size_t m_tail{0}; // Total bytes received
+  std::size_t m_lines{0};
+  std::size_t m_owed{0};  // Replies of this game not answered yet
+  std::size_t m_stale{0}; // Lines of previous games still to come
+  bool m_line_per_reply{false};
+};
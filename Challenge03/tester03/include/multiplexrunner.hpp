@@ -0,0 +1,82 @@
+#pragma once
+
+#include "aistats.hpp"
+#include "cputopology.hpp"
+#include "lineframer.hpp"
+#include "processwatch.hpp"
+#include "programoptions.hpp"
+#include "reproc++/reproc.hpp"
+#include "responsetable.hpp"
+#include "timecontrol.hpp"
+#include "virtualgames.hpp"
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/***
+ * @description Plays several independent games against one AI process at
+ * once (`run --ai N --games K`). Every line in both directions starts with
+ * the game slot ("2 S3", "0 B4"), the turns of the slots interleave and all
+ * replies of one read go out in a single write. Each slot keeps its own
+ * VirtualGames so the per game rules and timings are unchanged.
+ * */
+
+class MultiplexRunner {
+  struct Slot {
+    VirtualGames game;
+    std::size_t iterations{0};
+    std::size_t played{0};
+    std::size_t guess_count{0};
+    std::size_t owed{0};  // Replies of the current game not answered yet
+    std::size_t stale{0}; // Lines of earlier games still to come
+    TimeControl clock;
+    bool active{false};
+  };
+
+  std::vector<Slot> m_slots;
+  std::vector<std::string> m_tags; // "0 ", "1 ", ... built once
+  VirtualGames m_merged;
+  reproc::process m_app;
+  ProcessWatch m_watch;
+  LineFramer m_framer;
+  ResponseTable m_responses;
+  OutputBuffer m_out;
+  std::optional<cputopology::CpuPair> m_cpus{};
+  RawClock::time_point m_last_read{}; // Taken right after each read
+  std::atomic<std::size_t> m_round{0};
+  std::atomic<bool> m_completed{false};
+  bool m_tagged{false};   // The AI sent at least one tagged line
+  bool m_untagged{false}; // Its first line had no game number
+
+public:
+  MultiplexRunner(ProgramOptions::Options const &options, AIID aiid,
+                  std::size_t nbrGames);
+  MultiplexRunner(MultiplexRunner &&other) noexcept;
+  MultiplexRunner(const MultiplexRunner &) = delete;
+
+  void pin_to(cputopology::CpuPair cpus) { m_cpus = cpus; }
+  void start_tests(std::size_t nbrIterations);
+
+  // Every slot merged, only complete once the tests are done
+  const VirtualGames &games() const { return m_merged; }
+  std::size_t current_round() const noexcept { return m_round.load(); }
+  bool is_completed() const noexcept { return m_completed.load(); }
+  // The AI does not support --games, only valid once completed
+  bool answered_untagged() const noexcept { return m_untagged; }
+
+private:
+  bool initalize_app();
+  bool handle_line(std::string_view line);
+  void begin_game(std::size_t slot);
+  void end_game(std::size_t slot, VirtualGames::EndingState state);
+  void expire_games(RawClock::time_point now);
+  void fail_all(VirtualGames::EndingState state);
+  bool any_active() const;
+  RawClock::time_point next_deadline() const;
+  void record_budget(std::size_t slot);
+  void respond(std::size_t slot, std::string_view text);
+  void flush();
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "aiplugin.h"
+#include "aistats.hpp"
+#include "programoptions.hpp"
+#include "timecontrol.hpp"
+#include "virtualgames.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+
+/***
+ * @description A shared library implementing aiplugin.h, loaded once and
+ * shared read only by every PluginRunner.
+ * */
+
+class AiPlugin {
+public:
+  // Empty when the library cannot be loaded or misses a function
+  static std::unique_ptr<AiPlugin> load(std::string const &path);
+  // The AIs built into the tester, see referenceai.hpp
+  static std::unique_ptr<AiPlugin> reference();
+  ~AiPlugin();
+
+  AiPlugin(const AiPlugin &) = delete;
+  AiPlugin &operator=(const AiPlugin &) = delete;
+
+  decltype(&::ai_count) count{nullptr};
+  decltype(&::ai_new) create{nullptr};
+  decltype(&::ai_guess) guess{nullptr};
+  decltype(&::ai_feedback) feedback{nullptr};
+  decltype(&::ai_new_game) new_game{nullptr};
+  decltype(&::ai_delete) destroy{nullptr};
+
+private:
+  AiPlugin() = default;
+  void *m_library{nullptr};
+};
+
+/***
+ * @description Same job as TestRunner for an in process AI. The guess timer
+ * starts and stops at the same points, so results compare with process AIs.
+ * A move is only known to be too slow once it returns.
+ * */
+
+class PluginRunner {
+  VirtualGames m_game;
+  AiPlugin const *m_plugin{nullptr};
+  ai_handle *m_ai{nullptr};
+  TimeControl m_clock;
+  std::atomic<std::size_t> m_round{0};
+  std::atomic<bool> m_completed{false};
+
+public:
+  PluginRunner(ProgramOptions::Options const &options, AIID aiid,
+               AiPlugin const &plugin);
+  PluginRunner(PluginRunner &&other) noexcept;
+  PluginRunner(const PluginRunner &) = delete;
+  ~PluginRunner();
+
+  void start_tests(std::size_t nbrIterations);
+
+  const VirtualGames &games() const { return m_game; }
+  std::size_t current_round() const noexcept { return m_round.load(); }
+  bool is_completed() const noexcept { return m_completed.load(); }
+
+private:
+  void run_test();
+};
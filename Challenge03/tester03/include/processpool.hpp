@@ -0,0 +1,58 @@
+#pragma once
+
+#include "aistats.hpp"
+#include "reproc++/reproc.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/***
+ * @description Keeps started `run --ai N` processes ready so a runner never
+ * waits on a spawn. The processes needed up front are started in parallel and
+ * every process handed out is replaced by a warm spare in the background.
+ * */
+
+class ProcessPool {
+public:
+  // Every process is started with `run --ai N` followed by extra_args
+  ProcessPool(std::string program, std::size_t spares,
+              std::vector<std::string> extra_args = {});
+  ~ProcessPool();
+
+  ProcessPool(const ProcessPool &) = delete;
+  ProcessPool &operator=(const ProcessPool &) = delete;
+
+  // Starts count processes for each AI, plus the spares, all at once
+  void prewarm(std::vector<std::pair<AIID, std::size_t>> const &counts);
+
+  // A started process for the AI. Starts one now when no spare is ready.
+  std::optional<reproc::process> acquire(AIID id);
+
+  static std::optional<reproc::process>
+  start_process(std::string const &program, AIID id,
+                std::vector<std::string> const &extra_args = {});
+
+private:
+  void refill_loop(std::stop_token stop);
+  void request_spare(AIID id);
+
+  std::string m_program;
+  std::size_t m_spares;
+  std::vector<std::string> m_args;
+
+  std::mutex m_mutex;
+  std::condition_variable_any m_wake;
+  std::map<AIID, std::vector<reproc::process>> m_ready;
+  std::map<AIID, std::size_t> m_starting;
+  std::deque<AIID> m_to_start;
+
+  // Last so it stops before the members it uses are destroyed
+  std::jthread m_refill;
+};
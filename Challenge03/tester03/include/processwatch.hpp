@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <thread>
+
+#include <poll.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/***
+ * @description Tells a crashed AI process from one that only closed or broke
+ * its pipe. Uses a pidfd when the kernel has them (Linux 5.3+), otherwise
+ * peeks at the child with waitid. Never reaps the process, reproc or the
+ * event loop still does that.
+ * */
+
+class ProcessWatch {
+  int m_pid{-1};
+  int m_pidfd{-1};
+
+public:
+  // A dying process closes its pipes slightly before it becomes a zombie
+  static constexpr std::chrono::milliseconds settle_time{50};
+
+  ProcessWatch() = default;
+  explicit ProcessWatch(int pid) : m_pid(pid) {
+#ifdef SYS_pidfd_open
+    if (pid > 0)
+      m_pidfd = static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+#endif
+  }
+
+  ProcessWatch(const ProcessWatch &) = delete;
+  ProcessWatch &operator=(const ProcessWatch &) = delete;
+  ProcessWatch(ProcessWatch &&other) noexcept { *this = std::move(other); }
+  ProcessWatch &operator=(ProcessWatch &&other) noexcept {
+    if (this != &other) {
+      close();
+      m_pid = other.m_pid;
+      m_pidfd = other.m_pidfd;
+      other.m_pid = -1;
+      other.m_pidfd = -1;
+    }
+    return *this;
+  }
+  ~ProcessWatch() { close(); }
+
+  // True when the process has exited, waiting up to timeout for it to happen
+  bool exited(std::chrono::milliseconds timeout = settle_time) const {
+    if (m_pid <= 0)
+      return false;
+
+    if (m_pidfd >= 0) {
+      pollfd fd{m_pidfd, POLLIN, 0};
+      return ::poll(&fd, 1, static_cast<int>(timeout.count())) > 0;
+    }
+
+    auto const until = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+      siginfo_t info{};
+      if (::waitid(P_PID, static_cast<id_t>(m_pid), &info,
+                   WEXITED | WNOHANG | WNOWAIT) == 0 &&
+          info.si_pid != 0)
+        return true;
+      if (std::chrono::steady_clock::now() >= until)
+        return false;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+private:
+  void close() {
+    if (m_pidfd >= 0)
+      ::close(m_pidfd);
+    m_pidfd = -1;
+  }
+};
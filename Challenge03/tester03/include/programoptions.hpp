@@ -5,26 +5,46 @@
 #include <vector>
 namespace ProgramOptions {
 
-enum class RunMode { test, help, version, error };
-enum class FileOutput { csv, report };
+enum class RunMode { test, merge, calibrate, help, version, error };
+enum class FileOutput { csv, report, journal };
+enum class Engine { threads, epoll };
 
 struct Options {
   RunMode mode{RunMode::error};
   FileOutput filemode{FileOutput::report};
+  Engine engine{Engine::threads};
   std::size_t nbrIterations{2};
   std::size_t rowSize{10};
   std::size_t colSize{10};
   std::size_t smallestShip{2};
   std::size_t largestShip{5};
   std::size_t wait_upto_millis{500};
+  std::size_t game_budget_millis{0}; // 0 = no time budget per game
+  std::size_t increment_millis{0};
+  std::size_t max_threads{0}; // 0 = one per hardware thread
+  std::size_t event_loops{1};
+  std::size_t multiplex_games{1}; // Games played at once per AI process
+  std::size_t salvo_shots{1};     // Guesses per turn
+  std::size_t warmup_games{0};    // Left out of the latency histograms
+  std::size_t shard_index{0};     // This run is shard_index of shard_count
+  std::size_t shard_count{1};
   std::string program_to_test{};
   std::string ship_layout_file{};
   std::string result_file{""};
   std::string options_file{};
+  std::vector<std::string> journal_files{}; // Read by the merge command
 
   bool randomShips{true};
   bool display_histogram{false};
   bool all_ai{false};
+  bool pin_cpus{false};
+  bool shm_transport{false};
+  bool line_per_reply{false}; // The AI answers every reply, final S included
+  bool stats_only{false}; // Keep no guesses or boards, only the statistics
+  bool plugin{false};
+  bool reference_ais{false}; // Also play the AIs of referenceai.hpp
+  bool subtract_baseline{false}; // Measure echo_ai first, see calibrate
+  bool show_progress{true};
 
   std::vector<std::size_t> ai_id_to_test{};
 };
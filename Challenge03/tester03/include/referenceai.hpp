@@ -0,0 +1,36 @@
+#pragma once
+
+#include "aiplugin.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/***
+ * @description AIs built into tester03, played with `run --reference` next to
+ * the AIs under test. They implement the functions of aiplugin.h, so
+ * PluginRunner plays them in process on the same VirtualGames engine and
+ * layout as any plugin, with no pipes or processes in their answer times.
+ *
+ * 0: random, 1: hunt/target, 2: probability density. Their guesses per game
+ * and answer times are a fixed baseline for every report.
+ * */
+
+namespace reference {
+
+// Program name of the games played by the reference AIs
+inline constexpr std::string_view program_name{"reference"};
+
+std::size_t count();
+std::string_view name(std::size_t id);
+
+// "AI 3" for an AI under test, the reference AI name otherwise
+std::string label(std::string_view program, std::size_t id);
+
+ai_handle *create(std::size_t id, ai_layout const *layout);
+int guess(ai_handle *ai, std::uint32_t *row, std::uint32_t *col);
+void feedback(ai_handle *ai, int result, std::uint32_t ship_size);
+void new_game(ai_handle *ai);
+void destroy(ai_handle *ai);
+
+} // namespace reference
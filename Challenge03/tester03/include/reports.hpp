@@ -3,15 +3,19 @@
 #include <ostream>
 
 namespace report {
-void print_game_board(std::ostream &s, battleship::GameLayout const &layout,
-                      battleship::Ships const &ships);
+void print_game_board(std::ostream &s, VirtualGames const &games,
+                      VirtualGames::Game const &game);
 
 void print_single_game_stats(std::ostream &s, std::size_t id,
                              const VirtualGames::Game &game);
 void print_colors_on();
 void print_colors_off();
 
-void print_all_moves(std::ostream &s, const VirtualGames::Game &game);
+void print_all_moves(std::ostream &s, const VirtualGames &games,
+                     const VirtualGames::Game &game);
 void print_global_stats(std::ostream &s, const VirtualGames &games);
+// p50 to p99.9 of the answer times, overall and by phase
+void print_percentiles(std::ostream &s, const VirtualGames &games);
+void print_histogram(std::ostream &s, const VirtualGames &games);
 
 }; // namespace report
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "ship.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <format>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/***
+ * @description Every message the tester sends to an AI, formatted once from
+ * the GameLayout so answering a guess never has to build a string.
+ * */
+
+class ResponseTable {
+public:
+  ResponseTable() = default;
+  explicit ResponseTable(battleship::GameLayout const &layout)
+      : m_smallest(static_cast<std::size_t>(layout.minShipSize.size)) {
+    const auto largest = static_cast<std::size_t>(layout.maxShipSize.size);
+    for (std::size_t size = m_smallest; size <= largest; ++size)
+      m_sunk.push_back(std::format("S{}\n", size));
+  }
+
+  constexpr std::string_view miss() const noexcept { return "M\n"; }
+  constexpr std::string_view hit() const noexcept { return "H\n"; }
+  constexpr std::string_view new_game() const noexcept { return "E\n"; }
+  constexpr std::string_view quit() const noexcept { return "Q\n"; }
+
+  std::string_view sunk(battleship::ShipDefinition const shipdef) const {
+    return m_sunk[static_cast<std::size_t>(shipdef.size) - m_smallest];
+  }
+
+private:
+  std::size_t m_smallest{0};
+  std::vector<std::string> m_sunk{};
+};
+
+/***
+ * @description Collects the replies of a turn so they are sent with a single
+ * write. Returns false from append when the reply does not fit, flush first.
+ * */
+
+class OutputBuffer {
+public:
+  static constexpr std::size_t capacity = 256;
+
+  bool append(std::string_view text) noexcept {
+    if (text.size() > capacity - m_size)
+      return false;
+    std::ranges::copy(text, m_buffer.begin() + m_size);
+    m_size += text.size();
+    return true;
+  }
+
+  constexpr std::string_view view() const noexcept {
+    return {m_buffer.data(), m_size};
+  }
+  constexpr bool empty() const noexcept { return m_size == 0; }
+  constexpr std::size_t room() const noexcept { return capacity - m_size; }
+
+  // Removes bytes that were written, keeping any that were not
+  void consume(std::size_t bytes) noexcept {
+    std::ranges::copy(m_buffer.begin() + bytes, m_buffer.begin() + m_size,
+                      m_buffer.begin());
+    m_size -= bytes;
+  }
+
+  void clear() noexcept { m_size = 0; }
+
+private:
+  std::array<char, capacity> m_buffer{};
+  std::size_t m_size{0};
+};
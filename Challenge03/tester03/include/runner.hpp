@@ -1,3 +1,7 @@
 #include "programoptions.hpp"
 
 bool test(ProgramOptions::Options const &opt);
+// Combines the journals of a sharded run into one set of results
+bool merge(ProgramOptions::Options const &opt);
+// Measures the cost of the tester itself with echo_ai
+bool calibrate(ProgramOptions::Options const &opt);
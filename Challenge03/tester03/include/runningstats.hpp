@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+/***
+ * @description Count, mean and spread of a stream of values in constant
+ * memory. add() is Welford's update, merge() is Chan's parallel formula, so
+ * the accumulators of several games, runners or shards combine into exactly
+ * the result of one accumulator fed every value.
+ * */
+class RunningStats {
+public:
+  void add(double value) noexcept {
+    ++m_count;
+    double const delta = value - m_mean;
+    m_mean += delta / static_cast<double>(m_count);
+    m_m2 += delta * (value - m_mean);
+  }
+
+  void merge(RunningStats const &other) noexcept {
+    if (other.m_count == 0)
+      return;
+    if (m_count == 0) {
+      *this = other;
+      return;
+    }
+    auto const count = m_count + other.m_count;
+    double const delta = other.m_mean - m_mean;
+    double const weight = static_cast<double>(other.m_count) /
+                          static_cast<double>(count);
+    m_mean += delta * weight;
+    m_m2 += other.m_m2 + delta * delta * static_cast<double>(m_count) * weight;
+    m_count = count;
+  }
+
+  RunningStats &operator+=(RunningStats const &other) noexcept {
+    merge(other);
+    return *this;
+  }
+
+  // Rebuilds an accumulator written out by count(), mean() and m2()
+  static RunningStats from_moments(std::size_t count, double mean,
+                                   double m2) noexcept {
+    RunningStats stats;
+    stats.m_count = count;
+    stats.m_mean = count > 0 ? mean : 0.0;
+    stats.m_m2 = count > 1 ? m2 : 0.0;
+    return stats;
+  }
+
+  std::size_t count() const noexcept { return m_count; }
+  double mean() const noexcept { return m_mean; }
+  double m2() const noexcept { return m_m2; }
+
+  // Sample variance, 0 until there are two values
+  double variance() const noexcept {
+    return m_count > 1 ? m_m2 / static_cast<double>(m_count - 1) : 0.0;
+  }
+  double stddev() const noexcept { return std::sqrt(variance()); }
+
+  // Half width of the 95% confidence interval of the mean, normal
+  // approximation: mean() +- ci95()
+  double ci95() const noexcept {
+    if (m_count < 2)
+      return 0.0;
+    return 1.96 * stddev() / std::sqrt(static_cast<double>(m_count));
+  }
+
+private:
+  std::size_t m_count{0};
+  double m_mean{0.0};
+  double m_m2{0.0}; // Sum of squared differences from the mean
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "ship.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+/***
+ * @description A ship as its first cell, length and direction, 8 bytes
+ * whatever the size of the board or of the ship.
+ * */
+struct ShipPlacement {
+  std::uint16_t row{0};
+  std::uint16_t col{0};
+  std::uint16_t size{0};
+  bool across{true}; // Along a row, else down a column
+
+  // The row of a ship across, the column of a ship down
+  std::size_t lane() const noexcept { return across ? row : col; }
+  // First cell along its lane
+  std::size_t start() const noexcept { return across ? col : row; }
+  std::size_t end() const noexcept { return start() + size - 1; }
+
+  battleship::RowCol first_cell() const {
+    return battleship::RowCol{battleship::Row{row}, battleship::Col{col}};
+  }
+
+  bool covers(std::size_t cell_row, std::size_t cell_col) const noexcept {
+    auto const along = across ? cell_col : cell_row;
+    return (across ? cell_row : cell_col) == lane() && along >= start() &&
+           along <= end();
+  }
+
+  bool operator==(ShipPlacement const &) const = default;
+};
+
+/***
+ * @description Spatial index of the ships of one game. Ships across are
+ * sorted by row then column, ships down by column then row. Ships never
+ * overlap, so only the last ship of a lane starting at or before a cell can
+ * cover it: a lookup is two binary searches and the memory is a few bytes
+ * per ship, boards of 65535x65535 cost the same as 10x10.
+ * */
+class ShipIndex {
+public:
+  void clear() noexcept {
+    m_across.clear();
+    m_down.clear();
+  }
+
+  // Ship on the cell, nullptr for water
+  ShipPlacement const *find(std::size_t row, std::size_t col) const noexcept {
+    if (auto const *ship = last_from(m_across, row, col);
+        ship && ship->end() >= col)
+      return ship;
+    if (auto const *ship = last_from(m_down, col, row);
+        ship && ship->end() >= row)
+      return ship;
+    return nullptr;
+  }
+
+  // The ship does not overlap any ship of the index
+  bool fits(ShipPlacement const &ship) const {
+    auto const &same = ship.across ? m_across : m_down;
+    if (auto const *before = last_from(same, ship.lane(), ship.end());
+        before && before->end() >= ship.start())
+      return false;
+
+    // Ships of the other direction whose lane crosses the ship
+    auto const &other = ship.across ? m_down : m_across;
+    auto crossing = std::ranges::lower_bound(
+        other, key(ship.start(), 0), {}, [](ShipPlacement const &placed) {
+          return key(placed.lane(), placed.start());
+        });
+    for (; crossing != other.end() && crossing->lane() <= ship.end();
+         ++crossing) {
+      if (crossing->start() <= ship.lane() && crossing->end() >= ship.lane())
+        return false;
+    }
+    return true;
+  }
+
+  void add(ShipPlacement const &ship) {
+    auto &ships = ship.across ? m_across : m_down;
+    auto const at = std::ranges::upper_bound(
+        ships, key(ship.lane(), ship.start()), {},
+        [](ShipPlacement const &placed) {
+          return key(placed.lane(), placed.start());
+        });
+    ships.insert(at, ship);
+  }
+
+  std::size_t size() const noexcept { return m_across.size() + m_down.size(); }
+
+  // Ships across then down, in index order
+  std::vector<ShipPlacement> placements() const {
+    std::vector<ShipPlacement> ships;
+    ships.reserve(size());
+    ships.insert(ships.end(), m_across.begin(), m_across.end());
+    ships.insert(ships.end(), m_down.begin(), m_down.end());
+    return ships;
+  }
+
+private:
+  static std::uint64_t key(std::size_t lane, std::size_t start) noexcept {
+    return static_cast<std::uint64_t>(lane) << 32 |
+           static_cast<std::uint64_t>(start);
+  }
+
+  // Last ship of the lane starting at or before along, nullptr if none
+  static ShipPlacement const *last_from(std::vector<ShipPlacement> const &ships,
+                                        std::size_t lane,
+                                        std::size_t along) noexcept {
+    auto const after = std::ranges::upper_bound(
+        ships, key(lane, along), {}, [](ShipPlacement const &placed) {
+          return key(placed.lane(), placed.start());
+        });
+    if (after == ships.begin())
+      return nullptr;
+    auto const &ship = *std::prev(after);
+    return ship.lane() == lane ? &ship : nullptr;
+  }
+
+  std::vector<ShipPlacement> m_across;
+  std::vector<ShipPlacement> m_down;
+};
+
+namespace shipindex {
+
+// One ship of each size of the layout at random, without overlap. False
+// when a ship found no room, the index then holds the ships placed.
+bool random_fill(ShipIndex &index, battleship::GameLayout const &layout);
+
+} // namespace shipindex
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <thread>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+/***
+ * @description Layout of the optional shared memory transport, shared by the
+ * tester and any AI that supports `run --ai N --shm NAME`.
+ *
+ * NAME is a POSIX shared memory object holding one Channel. The tester
+ * creates it, the AI maps it and sets `attached` to 1. Then the same text
+ * lines as on the pipes go through two single producer / single consumer
+ * byte rings: to_ai for the replies, from_ai for the guesses. A reader spins
+ * for a short while and then sleeps on a futex on the ring tail. A writer
+ * that finds the ring full waits for room the same way, but polls: readers
+ * do not wake writers.
+ * */
+
+namespace shm {
+
+inline long futex(std::atomic<std::uint32_t> *word, int op, std::uint32_t value,
+                  const timespec *timeout = nullptr) {
+  return ::syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(word), op,
+                   value, timeout, nullptr, 0);
+}
+
+// Sleeps while word still holds seen, at most timeout
+inline void futex_wait(std::atomic<std::uint32_t> *word, std::uint32_t seen,
+                       std::chrono::nanoseconds timeout) {
+  timespec ts{static_cast<time_t>(timeout.count() / 1'000'000'000),
+              static_cast<long>(timeout.count() % 1'000'000'000)};
+  futex(word, FUTEX_WAIT, seen, &ts);
+}
+
+inline void futex_wake(std::atomic<std::uint32_t> *word) {
+  futex(word, FUTEX_WAKE, INT32_MAX);
+}
+
+struct Ring {
+  static constexpr std::uint32_t capacity = 4096; // Must be a power of two
+  static constexpr std::uint32_t mask = capacity - 1;
+  static constexpr int spin_count = 2000;
+  static constexpr std::chrono::microseconds full_poll{50};
+
+  alignas(64) std::atomic<std::uint32_t> head{0}; // Bytes consumed
+  alignas(64) std::atomic<std::uint32_t> tail{0}; // Bytes produced, futex word
+  std::atomic<std::uint32_t> sleeping{0};         // Consumer waits on tail
+  alignas(64) char data[capacity]{};
+
+  // Producer side. Copies as much of text as fits, returns the byte count.
+  std::size_t write(std::string_view text) noexcept {
+    auto const t = tail.load(std::memory_order_relaxed);
+    auto const h = head.load(std::memory_order_acquire);
+    auto const count =
+        std::min<std::size_t>(text.size(), capacity - (t - h));
+    for (std::size_t index = 0; index < count; ++index)
+      data[(t + index) & mask] = text[index];
+    tail.store(t + static_cast<std::uint32_t>(count),
+               std::memory_order_release);
+
+    // Pairs with the fence in wait_readable, one side always sees the other
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (count > 0 && sleeping.load(std::memory_order_relaxed))
+      futex_wake(&tail);
+    return count;
+  }
+
+  // Consumer side. Copies up to size bytes, returns the byte count.
+  std::size_t read(char *out, std::size_t size) noexcept {
+    auto const h = head.load(std::memory_order_relaxed);
+    auto const t = tail.load(std::memory_order_acquire);
+    auto const count = std::min<std::size_t>(size, t - h);
+    for (std::size_t index = 0; index < count; ++index)
+      out[index] = data[(h + index) & mask];
+    head.store(h + static_cast<std::uint32_t>(count),
+               std::memory_order_release);
+    return count;
+  }
+
+  // Producer side. True once there is room for at least one byte, false on
+  // timeout.
+  bool wait_writable(std::chrono::nanoseconds timeout) noexcept {
+    auto const full = [this] {
+      return tail.load(std::memory_order_relaxed) -
+                 head.load(std::memory_order_acquire) ==
+             capacity;
+    };
+    for (int spin = 0; spin < spin_count; ++spin) {
+      if (!full())
+        return true;
+    }
+
+    auto const until = std::chrono::steady_clock::now() + timeout;
+    while (full()) {
+      if (std::chrono::steady_clock::now() >= until)
+        return false;
+      std::this_thread::sleep_for(full_poll);
+    }
+    return true;
+  }
+
+  bool readable() const noexcept {
+    return tail.load(std::memory_order_acquire) !=
+           head.load(std::memory_order_relaxed);
+  }
+
+  // Consumer side. True once there is something to read, false on timeout.
+  bool wait_readable(std::chrono::nanoseconds timeout) noexcept {
+    for (int spin = 0; spin < spin_count; ++spin) {
+      if (readable())
+        return true;
+    }
+
+    auto const until = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+      sleeping.store(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      auto const seen = tail.load(std::memory_order_relaxed);
+      if (seen != head.load(std::memory_order_relaxed)) {
+        sleeping.store(0, std::memory_order_relaxed);
+        return true;
+      }
+
+      auto const remaining = until - std::chrono::steady_clock::now();
+      if (remaining <= std::chrono::nanoseconds::zero()) {
+        sleeping.store(0, std::memory_order_relaxed);
+        return false;
+      }
+      futex_wait(&tail, seen,
+                 std::chrono::duration_cast<std::chrono::nanoseconds>(remaining));
+    }
+  }
+};
+
+struct Channel {
+  static constexpr std::uint32_t magic_value = 0x42534831; // "BSH1"
+
+  std::uint32_t magic{magic_value};
+  std::atomic<std::uint32_t> attached{0}; // Set to 1 by the AI, futex word
+  Ring to_ai;
+  Ring from_ai;
+};
+
+} // namespace shm
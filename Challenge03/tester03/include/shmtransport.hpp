@@ -0,0 +1,43 @@
+#pragma once
+
+#include "lineframer.hpp"
+#include "shmring.hpp"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/***
+ * @description Tester side of the shared memory transport (see shmring.hpp).
+ * Owns the shared memory object and unlinks it when destroyed.
+ * */
+
+class ShmTransport {
+public:
+  // nullptr when the shared memory object cannot be created
+  static std::unique_ptr<ShmTransport> create();
+  ~ShmTransport();
+
+  ShmTransport(const ShmTransport &) = delete;
+  ShmTransport &operator=(const ShmTransport &) = delete;
+
+  const std::string &name() const noexcept { return m_name; }
+
+  // False when the AI did not map the channel in time, use the pipes then
+  bool wait_attached(std::chrono::milliseconds timeout);
+
+  // Writes all of text, waiting for room while the ring is full. False when
+  // the AI did not read it within timeout, part of text may be in the ring.
+  bool write(std::string_view text, std::chrono::nanoseconds timeout);
+
+  // Waits up to timeout for guesses and moves them into the framer. False
+  // on timeout.
+  bool read_into(LineFramer &framer, std::chrono::milliseconds timeout);
+
+private:
+  ShmTransport(std::string name, shm::Channel *channel)
+      : m_name(std::move(name)), m_channel(channel) {}
+
+  std::string m_name;
+  shm::Channel *m_channel;
+};
@@ -1,14 +1,27 @@
 #pragma once
 
 #include "aistats.hpp"
+#include "cputopology.hpp"
+#include "alloccount.hpp"
+#include "lineframer.hpp"
+#include "processpool.hpp"
+#include "processwatch.hpp"
 #include "programoptions.hpp"
 #include "reproc++/reproc.hpp"
 #include "reprochelper.hpp"
+#include "responsetable.hpp"
+#include "shmtransport.hpp"
+#include "timecontrol.hpp"
 #include "virtualgames.hpp"
 #include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
 #include <system_error>
+#include <vector>
 
 /***
  * @description Runs a set of tests on a program and keeps track of position
@@ -17,29 +30,67 @@
  * */
 
 class TestRunner {
+  static constexpr std::chrono::milliseconds SHM_ATTACH_WAIT{1000};
+
   VirtualGames m_game;
+  ProcessPool *m_pool{nullptr};
+  std::optional<cputopology::CpuPair> m_cpus{};
   reproc::process m_app;
-  reproc::milliseconds m_timeout{500};
+  ProcessWatch m_watch;
+  std::unique_ptr<ShmTransport> m_shm;
+  bool m_use_shm{false};
+  bool m_restart_needed{false};
+  LineFramer m_framer;
+  ResponseTable m_responses;
+  OutputBuffer m_out;
+  std::size_t m_salvo{1}; // Shots per turn
+  std::vector<battleship::RowCol> m_salvo_guesses;
+  std::vector<VirtualGames::GuessResult> m_salvo_results;
+  TimeControl m_clock;
+  RawClock::time_point m_last_read{}; // Taken right after each read
   std::atomic<std::size_t> m_round{0};
   std::atomic<bool> m_completed{false};
 
 public:
   TestRunner() {};
-  TestRunner(ProgramOptions::Options const &options, AIID aiid)
-      : m_timeout(options.wait_upto_millis) {
+  TestRunner(ProgramOptions::Options const &options, AIID aiid,
+             ProcessPool *pool = nullptr)
+      : m_pool(pool), m_use_shm(options.shm_transport),
+        m_salvo(std::max<std::size_t>(1, options.salvo_shots)),
+        m_clock(TimeControl::from_options(options)) {
     m_game = VirtualGames(
         options.program_to_test, aiid,
         {battleship::ShipDefinition{options.smallestShip},
          battleship::ShipDefinition{options.largestShip},
          battleship::Row{static_cast<battleship::Row::type>(options.rowSize)},
-         battleship::Col{static_cast<battleship::Col::type>(options.colSize)}});
+         battleship::Col{static_cast<battleship::Col::type>(options.colSize)}},
+        options.stats_only, options.warmup_games);
+    m_responses = ResponseTable{m_game.layout()};
+    m_framer.set_line_per_reply(options.line_per_reply);
+    if (m_salvo > 1) {
+      m_salvo_guesses.reserve(m_salvo);
+      m_salvo_results.resize(m_salvo);
+    }
   }
 
   TestRunner(const TestRunner &) = delete;
   TestRunner(TestRunner &&other) {
     m_game = std::move(other.m_game);
+    m_pool = other.m_pool;
+    m_cpus = other.m_cpus;
     m_app = std::move(other.m_app);
-    m_timeout = other.m_timeout;
+    m_watch = std::move(other.m_watch);
+    m_shm = std::move(other.m_shm);
+    m_use_shm = other.m_use_shm;
+    m_restart_needed = other.m_restart_needed;
+    m_framer = other.m_framer;
+    m_responses = std::move(other.m_responses);
+    m_out = other.m_out;
+    m_salvo = other.m_salvo;
+    m_salvo_guesses = std::move(other.m_salvo_guesses);
+    m_salvo_results = std::move(other.m_salvo_results);
+    m_clock = other.m_clock;
+    m_last_read = other.m_last_read;
     m_round.exchange(other.m_round);
     m_completed.exchange(other.m_completed);
   }
@@ -48,18 +99,30 @@ public:
 
   // TestRunner(TestRunner &&) = default;
 
+  // Runs the tests and the AI on a pair of nearby CPUs
+  void pin_to(cputopology::CpuPair cpus) { m_cpus = cpus; }
+
   void start_tests(std::size_t nbrIterations) {
-    if (!initalize_app(m_game.program_name(), m_game.aiid()))
+    if (m_cpus)
+      cputopology::pin_current_thread(m_cpus->runner_cpu);
+    if (!initalize_app(m_game.program_name(), m_game.aiid())) {
+      m_completed.store(true);
       return;
+    }
     m_round.store(0);
     m_completed.store(false);
     for (std::size_t test_nbr = 0; test_nbr < nbrIterations; ++test_nbr) {
       m_round.store(test_nbr);
+      if (m_restart_needed && !restart_app()) {
+        fail_remaining_games(nbrIterations - test_nbr);
+        break;
+      }
       begin_test();
       run_test();
     }
 
     send_quit();
+    flush();
     m_completed.store(true);
   };
 
@@ -74,87 +137,324 @@ public:
 
 private:
   bool initalize_app(std::string program, AIID id) {
+    m_shm.reset();
+    if (m_use_shm && initalize_app_shm(program, id))
+      return true;
 
-    reproc::options options{default_process_options()};
-    std::array<std::string, 4> cmdline{program, "run", "--ai",
-                                       std::to_string(id)};
-
-    auto ec = m_app.start(cmdline, options);
+    // The pool does not start salvo processes
+    auto app = m_pool && m_salvo == 1
+                   ? m_pool->acquire(id)
+                   : ProcessPool::start_process(program, id, ai_args());
+    if (!app) {
+      // std::cout << "Unable to start program\n";
+      return false;
+    }
+    use_app(std::move(app.value()));
+    return true;
+  }
 
-    if (ec == std::errc::no_such_file_or_directory) {
-      // std::cout << "No such program\n";
+  // Starts the AI with --shm. False when it has to be started again for the
+  // pipes, an AI that is alive but never attached keeps talking on the pipes.
+  bool initalize_app_shm(std::string const &program, AIID id) {
+    auto shm = ShmTransport::create();
+    if (!shm)
       return false;
-    } else if (ec) {
-      // std::cout << "Error: " << ec.message() << '\n';
+    auto args = ai_args();
+    args.insert(args.end(), {"--shm", shm->name()});
+    auto app = ProcessPool::start_process(program, id, args);
+    if (!app)
       return false;
+    use_app(std::move(app.value()));
+
+    if (shm->wait_attached(SHM_ATTACH_WAIT)) {
+      m_shm = std::move(shm);
+      return true;
     }
+    return !m_watch.exited();
+  }
+
+  // Options of the protocol the AI is started with after `run --ai N`
+  std::vector<std::string> ai_args() const {
+    std::vector<std::string> args;
+    if (m_framer.line_per_reply())
+      args.push_back("--line-per-reply");
+    if (m_salvo > 1)
+      args.insert(args.end(), {"--salvo", std::to_string(m_salvo)});
+    return args;
+  }
+
+  void use_app(reproc::process &&app) {
+    m_app = std::move(app);
+    m_watch = ProcessWatch{m_app.pid().first};
+    if (m_cpus)
+      cputopology::pin_process(m_app.pid().first, m_cpus->ai_cpu);
+  }
+
+  // The process died during the last game, start a new one with the same
+  // arguments (a warm spare when there is a pool)
+  bool restart_app() {
+    auto const start = VirtualGames::ClockT::now();
+    m_restart_needed = false;
+    m_framer.clear();
+    m_out.clear();
+    if (!initalize_app(m_game.program_name(), m_game.aiid()))
+      return false;
+
+    m_game.record_restart(std::chrono::duration_cast<VirtualGames::TimeT>(
+        VirtualGames::ClockT::now() - start));
     return true;
   }
 
+  void fail_remaining_games(std::size_t count) {
+    for (std::size_t game = 0; game < count; ++game) {
+      m_game.new_game();
+      m_game.end_game(VirtualGames::EndingState::crashed);
+    }
+  }
+
+  // Reading or polling failed. A process that died is recorded as a crash and
+  // replaced before the next game.
+  void end_game_on_error(
+      VirtualGames::EndingState state,
+      std::chrono::milliseconds settle = ProcessWatch::settle_time) {
+    if (m_watch.exited(settle)) {
+      m_game.end_game(VirtualGames::EndingState::crashed);
+      m_restart_needed = true;
+    } else {
+      m_game.end_game(state);
+    }
+  }
+
   // void end_test() {
   //   m_game.end_game(VirtualGames::EndingState::sunk_all_ships);
   // }
 
-  bool read_app() {
-    unsigned char buffer[128];
+  // Drops what the AI wrote for the game that ended, without waiting for
+  // lines it may still send. Only for an AI that does not answer every reply,
+  // the framer counts the lines of the others.
+  void drain() {
+    do {
+      m_framer.start_game();
+    } while (!m_framer.full() && read_ready());
+  }
+
+  // Reads what the AI already wrote, false when there is nothing
+  bool read_ready() {
+    if (m_shm)
+      return m_shm->read_into(m_framer, std::chrono::milliseconds(0));
+    auto event = m_app.poll(reproc::event::out, reproc::milliseconds(0));
+    return event.first == reproc::event::out && fill_framer();
+  }
+
+  // Reads whatever the AI has written so far into the framer
+  bool fill_framer() {
+    if (m_shm)
+      return false;
+
+    auto area = m_framer.write_area();
+    if (area.empty())
+      return false;
+
     std::size_t byteRead{0};
     std::error_code ec;
-    std::tie(byteRead, ec) =
-        m_app.read(reproc::stream::out, (unsigned char *)&buffer, 127);
+    std::tie(byteRead, ec) = m_app.read(
+        reproc::stream::out, (unsigned char *)area.data(), area.size());
+    if (byteRead == 0 || ec)
+      return false;
 
-    if (byteRead > 0 && !ec) {
-      std::string_view recieved_text{(char *)buffer, byteRead};
+    m_last_read = RawClock::now();
+    m_framer.commit(byteRead);
+    return true;
+  }
 
-      if (buffer[0] == '-') {
-        m_game.end_game(VirtualGames::EndingState::program_has_no_guesses);
-        return true;
-      }
+  enum class ReadResult { answered, no_guesses, late, unreadable };
+
+  // Handles exactly one guess, any extra line stays buffered for the next turn
+  ReadResult read_app() {
+    auto line = m_framer.next_line();
+    if (!line)
+      return ReadResult::unreadable;
+
+    std::string_view recieved_text = line.value();
+
+    if (!recieved_text.empty() && recieved_text.front() == '-') {
+      m_game.end_game(VirtualGames::EndingState::program_has_no_guesses);
+      return ReadResult::no_guesses;
+    }
+
+    // A partial line may have been read in time, the move counts once the
+    // line is complete
+    bool const in_time = m_clock.answered(m_last_read);
+    record_budget();
+    if (!in_time) {
+      m_game.end_game(VirtualGames::EndingState::timeout);
+      return ReadResult::late;
+    }
+
+    if (m_salvo > 1)
+      return read_salvo(recieved_text);
+
+    // Counted when built with TESTER03_COUNT_ALLOCATIONS
+    alloccount::Scope allocations;
+    auto guess = battleship::RowCol::from_string(recieved_text);
+    auto result = m_game.guess(guess);
+    switch (result.report) {
+    case VirtualGames::GuessReport::Hit:
+      hit_ship(result.ship);
+      break;
+    case VirtualGames::GuessReport::Sink:
+      sunk_ship(result.ship);
+      break;
+    case VirtualGames::GuessReport::Miss:
+      miss_ship();
+      break;
+    }
+    m_game.count_move_allocations(allocations.count());
+    return ReadResult::answered;
+  }
 
-      auto guess = battleship::RowCol::from_string(recieved_text);
-      auto result = m_game.guess(guess);
-      switch (result.report) {
-      case VirtualGames::GuessReport::Hit:
-        hit_ship(result.ship);
-        return true;
-      case VirtualGames::GuessReport::Sink:
-        sunk_ship(result.ship);
-        return true;
-      case VirtualGames::GuessReport::Miss:
-        miss_ship();
-        return true;
+  // One line of up to m_salvo guesses ("A1 B2 C3") answered by one line with
+  // a result per shot ("M H S3"). Shots after the last ship sinks get no
+  // result.
+  ReadResult read_salvo(std::string_view text) {
+    alloccount::Scope allocations;
+    m_salvo_guesses.clear();
+    while (!text.empty()) {
+      auto const end = text.find(' ');
+      auto const shot = text.substr(0, end);
+      if (!shot.empty()) {
+        if (m_salvo_guesses.size() == m_salvo)
+          return ReadResult::unreadable;
+        m_salvo_guesses.push_back(battleship::RowCol::from_string(shot));
       }
+      if (end == std::string_view::npos)
+        break;
+      text.remove_prefix(end + 1);
     }
-    return false;
+    if (m_salvo_guesses.empty())
+      return ReadResult::unreadable;
+
+    auto const shots = m_game.guess_salvo(m_salvo_guesses, m_salvo_results);
+    for (std::size_t shot = 0; shot < shots; ++shot) {
+      auto answer = answer_text(m_salvo_results[shot]);
+      answer.remove_suffix(1); // Every answer of the table ends with '\n'
+      respond(answer);
+      respond(shot + 1 == shots ? "\n" : " ");
+    }
+    m_framer.reply_sent();
+    start_move();
+    m_game.count_move_allocations(allocations.count());
+    return ReadResult::answered;
   }
 
-  void run_test() {
-    // std::cout << "Run Tests\n";
-    std::size_t count{0};
-    const std::size_t MAX_COUNT = m_game.max_guesses();
+  // The answer is about to be sent, the time of the next move starts
+  void start_move() {
     m_game.start_guess_timer();
-    while (1) {
+    m_clock.start_move();
+  }
+
+  void record_budget() {
+    if (m_clock.has_budget())
+      m_game.record_budget_left(std::chrono::duration_cast<VirtualGames::TimeT>(
+          m_clock.budget_left()));
+  }
+
+  // No line before the deadline, whatever time was left is used up
+  void end_on_timeout() {
+    m_clock.answered(RawClock::now());
+    record_budget();
+    m_game.end_game(VirtualGames::EndingState::timeout);
+  }
+
+  std::string_view answer_text(VirtualGames::GuessResult const result) const {
+    switch (result.report) {
+    case VirtualGames::GuessReport::Hit:
+      return m_responses.hit();
+    case VirtualGames::GuessReport::Sink:
+      return m_responses.sunk(result.ship);
+    case VirtualGames::GuessReport::Miss:
+      break;
+    }
+    return m_responses.miss();
+  }
+
+  // Waits until a whole line is buffered, a partial line does not get a new
+  // timeout. Ends the game when no line arrives.
+  bool wait_for_line() {
+    if (!flush()) {
+      end_on_timeout();
+      return false;
+    }
+    while (!m_framer.has_line()) {
+      auto const remaining = reproc::milliseconds(
+          TimeControl::poll_millis(m_clock.remaining(RawClock::now())));
+      if (remaining.count() <= 0) {
+        end_on_timeout();
+        return false;
+      }
+
+      if (m_shm) {
+        // No pipe to signal a dead AI, a crash shows up as a time out
+        if (m_framer.full()) {
+          end_game_on_error(VirtualGames::EndingState::unable_read_output);
+          return false;
+        }
+        if (!m_shm->read_into(m_framer, remaining)) {
+          record_budget();
+          end_game_on_error(VirtualGames::EndingState::timeout,
+                            std::chrono::milliseconds(0));
+          return false;
+        }
+        m_last_read = RawClock::now();
+        continue;
+      }
+
       auto event =
-          m_app.poll(reproc::event::out | reproc::event::deadline, m_timeout);
+          m_app.poll(reproc::event::out | reproc::event::deadline, remaining);
       if (event.first == reproc::event::deadline) {
-        m_game.end_game(VirtualGames::EndingState::timeout);
+        end_on_timeout();
         // std::cout << "Timeout\n";
-        return;
+        return false;
       } else if (event.second.value() != 0) {
 
         // std::cout << "other\n";
-        m_game.end_game(VirtualGames::EndingState::other);
-        return;
+        end_game_on_error(VirtualGames::EndingState::other);
+        return false;
       } else if (event.first == 0) {
         // std::cout << "Timeout\n";
-        m_game.end_game(VirtualGames::EndingState::timeout);
+        end_on_timeout();
+        return false;
+      }
+      if (!fill_framer()) {
+        // std::cout << "cannot read output\n";
+        end_game_on_error(VirtualGames::EndingState::unable_read_output);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void run_test() {
+    // std::cout << "Run Tests\n";
+    const std::size_t MAX_COUNT = m_game.max_guesses();
+    m_game.start_guess_timer();
+    while (1) {
+      if (m_framer.has_line()) {
+        // Sent before the answer to the previous guess
+        m_game.early_guess();
+      } else if (!wait_for_line()) {
         return;
       }
-      if (!read_app()) {
+      auto const read = read_app();
+      if (read == ReadResult::no_guesses || read == ReadResult::late)
+        return;
+      if (read == ReadResult::unreadable) {
         // std::cout << "cannot read output\n";
-        m_game.end_game(VirtualGames::EndingState::unable_read_output);
+        end_game_on_error(VirtualGames::EndingState::unable_read_output);
         return;
       }
-      if (++count > MAX_COUNT) {
+      // Counted in shots, a salvo turn can make several guesses
+      if (m_game.get_current_guess_count() > MAX_COUNT) {
         // std::cout << "max count\n";
         m_game.end_game(VirtualGames::EndingState::too_many_guess);
         return;
@@ -167,45 +467,68 @@ private:
     }
   }
   void begin_test() {
-    // Clear the input buffer so last guess not ending up in the next game
-    std::size_t byteRead{0};
-    std::pair<int, std::error_code> event;
-    unsigned char buffer[128];
-    do {
-      byteRead = 0;
-      event = m_app.poll(reproc::event::out, reproc::milliseconds(1));
-      if (event.first == reproc::event::out) {
-        std::error_code ec;
-        std::tie(byteRead, ec) =
-            m_app.read(reproc::stream::out, (unsigned char *)&buffer, 127);
-      }
-    } while (byteRead > 0);
-
-    m_app.write((unsigned char *)"E\n", 2);
+    // Whatever the AI still sends for the last game is dropped
+    if (!m_framer.line_per_reply())
+      drain();
+    m_framer.start_game();
+    m_framer.reply_sent();
+    respond(m_responses.new_game());
     m_game.new_game();
-    m_game.start_guess_timer();
+    m_clock.start_game();
+    record_budget();
+    start_move();
   }
 
   void sunk_ship(battleship::ShipDefinition const shipdef) {
     // std::cout << "Sunk ship: " << shipdef.size << '\n';
-    std::string buf = std::format("S{}\n", shipdef.size);
-    m_app.write((unsigned char *)buf.c_str(), buf.length());
-    m_game.start_guess_timer();
+    respond(m_responses.sunk(shipdef));
+    m_framer.reply_sent();
+    start_move();
   }
 
   void hit_ship(battleship::ShipDefinition const shipdef) {
     // std::cout << "Hit ship: " << shipdef.size << '\n';
-    m_app.write((unsigned char *)"H\n", 2);
-    m_game.start_guess_timer();
+    respond(m_responses.hit());
+    m_framer.reply_sent();
+    start_move();
   }
 
   void miss_ship() {
     // std::cout << "Miss\n";
-    m_app.write((unsigned char *)"M\n", 2);
-    m_game.start_guess_timer();
+    respond(m_responses.miss());
+    m_framer.reply_sent();
+    start_move();
   }
   void send_quit() {
     // std::cout << "Miss\n";
-    m_app.write((unsigned char *)"Q\n", 2);
+    respond(m_responses.quit());
+  }
+
+  // Replies are only sent when the runner waits for the AI, so one turn is at
+  // most one write
+  void respond(std::string_view text) {
+    if (!m_out.append(text)) {
+      flush();
+      m_out.append(text);
+    }
+  }
+
+  // False when the AI did not take the replies from the shared memory ring
+  // before the move deadline. They may be cut short in the ring, so the
+  // next game starts a new process and channel.
+  bool flush() {
+    if (m_out.empty())
+      return true;
+    bool sent = true;
+    if (m_shm) {
+      auto const wait = std::chrono::milliseconds(
+          TimeControl::poll_millis(m_clock.remaining(RawClock::now())));
+      sent = m_shm->write(m_out.view(), wait);
+      m_restart_needed = m_restart_needed || !sent;
+    } else {
+      m_app.write((unsigned char *)m_out.view().data(), m_out.view().size());
+    }
+    m_out.clear();
+    return sent;
   }
 };
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "programoptions.hpp"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <ctime>
+
+/***
+ * @description Chess style clock for one AI. Three modes, picked from the
+ * options:
+ *  - per move: every answer within `--wait` ms (the default)
+ *  - per game: the answers of a game share `--budget` ms
+ *  - base plus increment: `--budget` ms, `--increment` ms added after each
+ *    answer given in time
+ * A per move limit and a game budget can be combined, whichever is reached
+ * first ends the game. Times come from CLOCK_MONOTONIC_RAW, taken by the
+ * runners right after reading the AI output.
+ * */
+
+// Not slewed by NTP, a clock adjustment cannot move a deadline
+struct RawClock {
+  using duration = std::chrono::nanoseconds;
+  using rep = duration::rep;
+  using period = duration::period;
+  using time_point = std::chrono::time_point<RawClock>;
+  static constexpr bool is_steady = true;
+
+  static time_point now() noexcept {
+#ifdef CLOCK_MONOTONIC_RAW
+    timespec ts{};
+    ::clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return time_point{std::chrono::seconds(ts.tv_sec) +
+                      std::chrono::nanoseconds(ts.tv_nsec)};
+#else
+    return time_point{std::chrono::duration_cast<duration>(
+        std::chrono::steady_clock::now().time_since_epoch())};
+#endif
+  }
+};
+
+class TimeControl {
+public:
+  using Duration = RawClock::duration;
+
+  struct Settings {
+    std::chrono::milliseconds move{500};    // 0 = no limit per move
+    std::chrono::milliseconds game{0};      // 0 = no budget per game
+    std::chrono::milliseconds increment{0}; // Only used with a game budget
+  };
+
+  TimeControl() = default;
+  explicit TimeControl(Settings settings) : m_settings(settings) {}
+
+  static Settings from_options(ProgramOptions::Options const &options) {
+    return {std::chrono::milliseconds(options.wait_upto_millis),
+            std::chrono::milliseconds(options.game_budget_millis),
+            std::chrono::milliseconds(options.increment_millis)};
+  }
+
+  bool has_budget() const noexcept { return m_settings.game.count() > 0; }
+
+  void start_game(RawClock::time_point now = RawClock::now()) noexcept {
+    m_budget = m_settings.game;
+    m_move_start = now;
+  }
+
+  // The tester sent its answer, the AI is thinking from now on
+  void start_move(RawClock::time_point now = RawClock::now()) noexcept {
+    m_move_start = now;
+  }
+
+  RawClock::time_point deadline() const noexcept {
+    auto limit = Duration::max();
+    if (m_settings.move.count() > 0)
+      limit = m_settings.move;
+    if (has_budget())
+      limit = std::min(limit, std::max(Duration{0}, m_budget));
+    if (limit == Duration::max())
+      return RawClock::time_point::max();
+    return m_move_start + limit;
+  }
+
+  Duration remaining(RawClock::time_point now) const noexcept {
+    auto const until = deadline();
+    if (until == RawClock::time_point::max())
+      return Duration::max();
+    return std::max(Duration{0}, until - now);
+  }
+
+  // Charges the move that was read at now to the budget. False when it came
+  // after the deadline.
+  bool answered(RawClock::time_point now) noexcept {
+    bool const in_time = now <= deadline();
+    if (has_budget()) {
+      // A guess sent early was read before its move started
+      m_budget -= std::max(Duration{0}, now - m_move_start);
+      if (in_time)
+        m_budget += m_settings.increment;
+    }
+    return in_time;
+  }
+
+  Duration budget_left() const noexcept {
+    return std::max(Duration{0}, m_budget);
+  }
+
+  // Wait for poll and epoll_wait, rounded up so it never wakes up early
+  static int poll_millis(Duration remaining) noexcept {
+    auto const millis = std::chrono::ceil<std::chrono::milliseconds>(
+        std::min(remaining, Duration{std::chrono::hours(1)}));
+    return static_cast<int>(std::clamp<std::chrono::milliseconds::rep>(
+        millis.count(), 0, INT_MAX));
+  }
+
+private:
+  Settings m_settings{};
+  Duration m_budget{0};
+  RawClock::time_point m_move_start{};
+};
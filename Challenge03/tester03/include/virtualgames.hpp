@@ -1,9 +1,17 @@
 #pragma once
 #include "aistats.hpp"
+#include "boardstate.hpp"
+#include "latencyhistogram.hpp"
+#include "runningstats.hpp"
 #include "ship.hpp"
-#include <bitset>
+#include "shipindex.hpp"
 #include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <vector>
 
 class VirtualGames {
   // Types used
@@ -11,14 +19,6 @@ public:
   using TimeT = std::chrono::microseconds;
   using ClockT = std::chrono::high_resolution_clock;
 
-  struct ShipHit {
-    std::bitset<32> hits;
-    battleship::ShipDefinition id;
-    constexpr bool is_sunk() const { return hits.count() == id.size; }
-  };
-
-  using ShipHits = std::vector<ShipHit>;
-
   enum class GuessReport { Hit, Miss, Sink };
 
   struct GuessResult {
@@ -34,9 +34,16 @@ public:
     unable_read_output,
     sunk_all_ships,
     program_has_no_guesses,
-    none
+    crashed,
+    none,
+    // The ships of the layout could not be placed, the game had no board.
+    // Kept last, journals store the states by value.
+    ships_not_placed
   };
 
+  static constexpr std::size_t EndingState_Count =
+      static_cast<std::size_t>(EndingState::ships_not_placed) + 1;
+
   static constexpr const std::string EndingState_ToString(EndingState state) {
     switch (state) {
       using enum EndingState;
@@ -54,8 +61,34 @@ public:
       return "Sunk all ships";
     case program_has_no_guesses:
       return "Program has no guesses";
+    case crashed:
+      return "Program crashed";
     case none:
       return "No state set";
+    case ships_not_placed:
+      return "Ships could not be placed";
+    }
+  };
+
+  // State of the game when the AI made a guess
+  enum class Phase {
+    opening, // Nothing hit yet
+    hunt,    // Every ship hit so far is sunk
+    target,  // A ship is hit but still afloat
+  };
+
+  static constexpr std::size_t Phase_Count =
+      static_cast<std::size_t>(Phase::target) + 1;
+
+  static constexpr const std::string Phase_ToString(Phase phase) {
+    switch (phase) {
+      using enum Phase;
+    case opening:
+      return "Opening";
+    case hunt:
+      return "Hunt";
+    case target:
+      return "Target";
     }
   };
 
@@ -68,11 +101,39 @@ public:
     std::size_t repeat_guess_count{0};
     std::size_t invalid_guess_count{0};
     std::size_t total_guess_count{0};
+    std::size_t turn_count{0}; // Equal to total_guess_count unless salvo mode
+    std::size_t early_guess_count{0}; // Already waiting when the turn began
+    std::size_t move_allocations{0};  // See alloccount.hpp
+    TimeT budget_left{0}; // Game budget left at the end, see TimeControl
+    bool timed_budget{false};
+    RunningStats answer_times; // Microseconds, one value per guess
   };
   ;
+  // Averages are kept as sums and counts, spreads as RunningStats, shards of
+  // a run merge exactly
   struct GlobalRunStats : public VirtualStats {
+    std::size_t game_count{0};
     std::size_t average_guess_count{0};
-    std::array<std::size_t, 8> ending_state_counts{};
+    std::array<std::size_t, EndingState_Count> ending_state_counts{};
+    std::size_t restart_count{0};
+    TimeT restart_time{0}; // Total time spent replacing crashed processes
+    TimeT longest_restart{0};
+    std::size_t budget_games{0}; // Games played with a time budget
+    TimeT lowest_budget_left{TimeT::max()};
+    RunningStats guesses_per_game;
+    // Answer times by phase, recorded as the guesses come in, without the
+    // warmup games
+    std::array<LatencyHistogram, Phase_Count> latency{};
+    // Answer times of echo_ai on the same transport, the cost of the tester
+    // in every answer time above. Empty unless run --baseline.
+    RunningStats harness;
+
+    LatencyHistogram all_latency() const {
+      LatencyHistogram all;
+      for (auto const &phase : latency)
+        all += phase;
+      return all;
+    }
 
     std::size_t ending_state(EndingState state) const {
       return ending_state_counts[static_cast<std::size_t>(state)];
@@ -82,49 +143,66 @@ public:
       ++ending_state_counts[static_cast<std::size_t>(state)];
     }
 
+    void update_averages() {
+      if (total_guess_count > 0)
+        avg_answer =
+            total_time / static_cast<TimeT::rep>(total_guess_count);
+      if (game_count > 0)
+        average_guess_count = total_guess_count / game_count;
+    }
+
     GlobalRunStats &operator+=(GlobalRunStats const &other) {
       shortest_answer = std::min(shortest_answer, other.shortest_answer);
       longest_answer = std::max(longest_answer, other.longest_answer);
-      if (avg_answer.count() == 0)
-        avg_answer = other.avg_answer;
-      else
-        avg_answer = (avg_answer + other.avg_answer) / 2;
       total_time += other.total_time;
 
       repeat_guess_count += other.repeat_guess_count;
       invalid_guess_count += other.invalid_guess_count;
       total_guess_count += other.total_guess_count;
-
-      if (average_guess_count == 0)
-        average_guess_count = other.average_guess_count;
-      else
-        average_guess_count =
-            (average_guess_count + other.average_guess_count) / 2;
+      turn_count += other.turn_count;
+      early_guess_count += other.early_guess_count;
+      move_allocations += other.move_allocations;
+      game_count += other.game_count;
+      answer_times.merge(other.answer_times);
+      guesses_per_game.merge(other.guesses_per_game);
+      for (std::size_t phase = 0; phase < Phase_Count; ++phase)
+        latency[phase] += other.latency[phase];
+      harness.merge(other.harness);
 
       std::transform(ending_state_counts.begin(), ending_state_counts.end(),
                      other.ending_state_counts.begin(),
                      ending_state_counts.begin(), std::plus{});
+      restart_count += other.restart_count;
+      restart_time += other.restart_time;
+      longest_restart = std::max(longest_restart, other.longest_restart);
+      budget_left += other.budget_left;
+      budget_games += other.budget_games;
+      lowest_budget_left =
+          std::min(lowest_budget_left, other.lowest_budget_left);
+      update_averages();
       return *this;
     };
 
     GlobalRunStats &operator+=(VirtualStats const other) {
       shortest_answer = std::min(shortest_answer, other.shortest_answer);
       longest_answer = std::max(longest_answer, other.longest_answer);
-      if (avg_answer.count() == 0)
-        avg_answer = other.avg_answer;
-      else
-        avg_answer = (avg_answer + other.avg_answer) / 2;
       total_time += other.total_time;
 
       repeat_guess_count += other.repeat_guess_count;
       invalid_guess_count += other.invalid_guess_count;
       total_guess_count += other.total_guess_count;
-      if (average_guess_count == 0) {
-        average_guess_count = other.total_guess_count;
-      } else {
-        average_guess_count =
-            (average_guess_count + other.total_guess_count) / 2;
+      turn_count += other.turn_count;
+      early_guess_count += other.early_guess_count;
+      move_allocations += other.move_allocations;
+      ++game_count;
+      answer_times.merge(other.answer_times);
+      guesses_per_game.add(static_cast<double>(other.total_guess_count));
+      if (other.timed_budget) {
+        budget_left += other.budget_left;
+        ++budget_games;
+        lowest_budget_left = std::min(lowest_budget_left, other.budget_left);
       }
+      update_averages();
       return *this;
     }
   };
@@ -158,35 +236,208 @@ public:
     }
   };
 
+  /***
+   * @description Guesses of every finished game, stored in columns shared by
+   * all the games of one VirtualGames:
+   *  - cells: row and col packed in 32 bits
+   *  - results: one 4 bit code per guess, two per byte
+   *  - latency: the answer time as a zigzag varint of the difference with
+   *    the previous guess of the same game, one or two bytes for most guesses
+   * About 6 bytes a guess instead of sizeof(Guess_Stats), and three growing
+   * arrays instead of one allocation per game. A game is read back through
+   * a View, decoding one guess at a time.
+   * */
+  class History {
+  public:
+    struct Range {
+      std::size_t first{0};   // Index of the first guess in the columns
+      std::size_t count{0};
+      std::size_t latency{0}; // Offset of its first latency byte
+    };
+
+    class iterator {
+    public:
+      using iterator_concept = std::forward_iterator_tag;
+      using iterator_category = std::input_iterator_tag;
+      using value_type = Guess_Stats;
+      using reference = Guess_Stats;
+      using difference_type = std::ptrdiff_t;
+
+      iterator() = default;
+      iterator(History const &history, std::size_t index, std::size_t last,
+               std::size_t latency)
+          : m_history(&history), m_index(index), m_last(last),
+            m_latency(latency) {
+        load();
+      }
+
+      Guess_Stats operator*() const {
+        return m_history->decode(m_index, m_elapsed);
+      }
+      iterator &operator++() {
+        ++m_index;
+        load();
+        return *this;
+      }
+      iterator operator++(int) {
+        auto copy = *this;
+        ++*this;
+        return copy;
+      }
+      bool operator==(iterator const &other) const {
+        return m_index == other.m_index;
+      }
+
+    private:
+      void load() {
+        if (m_index < m_last)
+          m_elapsed += m_history->read_latency(m_latency);
+      }
+
+      History const *m_history{nullptr};
+      std::size_t m_index{0};
+      std::size_t m_last{0};
+      std::size_t m_latency{0};
+      TimeT m_elapsed{0};
+    };
+
+    class View {
+    public:
+      View(History const &history, Range range)
+          : m_history(&history), m_range(range) {}
+
+      iterator begin() const {
+        return {*m_history, m_range.first, last(), m_range.latency};
+      }
+      iterator end() const { return {*m_history, last(), last(), 0}; }
+      std::size_t size() const noexcept { return m_range.count; }
+      bool empty() const noexcept { return m_range.count == 0; }
+
+    private:
+      std::size_t last() const noexcept {
+        return m_range.first + m_range.count;
+      }
+
+      History const *m_history;
+      Range m_range;
+    };
+
+    // Any range of Guess_Stats, a vector for a game just played or the View
+    // of a game kept by another VirtualGames
+    template <class Guesses> Range append(Guesses const &guesses) {
+      Range range{m_cells.size(), 0, m_latency.size()};
+      TimeT previous{0};
+      for (Guess_Stats const guess : guesses) {
+        push(guess, previous);
+        previous = guess.elapsed_time;
+        ++range.count;
+      }
+      return range;
+    }
+
+    View view(Range range) const { return {*this, range}; }
+
+  private:
+    void push(Guess_Stats const &guess, TimeT previous);
+    Guess_Stats decode(std::size_t index, TimeT elapsed) const;
+    // Difference with the previous guess, moves offset past the varint
+    TimeT read_latency(std::size_t &offset) const;
+
+    std::vector<std::uint32_t> m_cells;
+    std::vector<std::uint8_t> m_results;
+    std::vector<std::uint8_t> m_latency;
+  };
+
+  // A finished game. Its guesses and ships are kept in the columns of the
+  // VirtualGames that played it, see guesses_of and ships_of.
   struct Game {
     std::chrono::high_resolution_clock::time_point start_time;
-    battleship::Ships ships;
-    ShipHits hits;
+    History::Range guesses;
+    std::size_t ships{0}; // Offset in the ship column
+    std::size_t ship_count{0};
+    VirtualStats stats;
+    EndingState ending_state{EndingState::none};
+  };
+
+  // The game being played, or a game read back from a journal before it is
+  // stored
+  struct PlayedGame {
+    std::chrono::high_resolution_clock::time_point start_time;
+    // Empty for the games of a --stats-only journal
+    std::vector<ShipPlacement> ships;
     std::vector<Guess_Stats> guesses;
     VirtualStats stats;
     EndingState ending_state{EndingState::none};
   };
 
+  // Ships are placed by shipindex::random_fill. Boards up to this many
+  // cells, with ships of up to 255 cells, are played on a byte per cell.
+  // Larger ones are played on the ShipIndex alone.
+  static constexpr std::size_t max_dense_cells = std::size_t{1} << 16;
+  // Boards larger than this on a side are listed ship by ship in the
+  // reports instead of drawn cell by cell
+  static constexpr std::size_t max_drawn_side = 100;
+
   // Public methods
 public:
   VirtualGames() {};
+  // stats_only keeps the statistics of every game but none of its guesses
+  // or board, see --stats-only. The answers of the first warmup_games games
+  // are left out of the latency histograms, see --warmup.
   explicit VirtualGames(std::string program, AIID ai,
-                        battleship::GameLayout layout)
-      : m_program_name(program), m_id(ai), m_layout(layout) {};
+                        battleship::GameLayout layout, bool stats_only = false,
+                        std::size_t warmup_games = 0)
+      : m_program_name(program), m_id(ai), m_layout(layout),
+        m_stats_only(stats_only), m_warmup_games(warmup_games) {};
 
   void new_game();
   void end_game(EndingState state);
   void start_guess_timer();
+  void early_guess() { ++m_current.stats.early_guess_count; }
+  void count_move_allocations(std::size_t count) {
+    m_current.stats.move_allocations += count;
+  }
+  void record_budget_left(TimeT left) {
+    m_current.stats.budget_left = left;
+    m_current.stats.timed_budget = true;
+  }
+  void record_restart(TimeT latency) {
+    ++m_global.restart_count;
+    m_global.restart_time += latency;
+    m_global.longest_restart = std::max(m_global.longest_restart, latency);
+  }
   void finish_games();
+  void merge(VirtualGames const &other);
+  // Rebuilds a finished game and the restarts from a journal. The totals of
+  // the stats are recomputed from the guesses when there are any.
+  void restore_game(PlayedGame game);
+  void record_harness(RunningStats const &harness) {
+    m_global.harness.merge(harness);
+  }
+  void restore_latency(Phase phase, LatencyHistogram const &histogram) {
+    m_global.latency[static_cast<std::size_t>(phase)] += histogram;
+  }
+  void restore_restarts(std::size_t count, TimeT time, TimeT longest) {
+    m_global.restart_count += count;
+    m_global.restart_time += time;
+    m_global.longest_restart = std::max(m_global.longest_restart, longest);
+  }
   GuessResult guess(const battleship::RowCol guess);
+  // Every shot of one salvo turn, the time of the turn is split evenly
+  // between them. Stops once all ships are sunk, returns the number of shots
+  // written to results.
+  std::size_t guess_salvo(std::span<const battleship::RowCol> guesses,
+                          std::span<GuessResult> results);
 
   // Getters
   constexpr std::size_t get_current_guess_count() {
-    return m_current.guesses.size();
+    return m_current.stats.total_guess_count;
   }
 
   constexpr std::size_t max_guesses() const noexcept {
-    return (m_layout.nbrRows.size * m_layout.nbrCols.size) + 10;
+    return static_cast<std::size_t>(m_layout.nbrRows.size) *
+               m_layout.nbrCols.size +
+           10;
   }
 
   bool sunk_all_ships() const;
@@ -195,11 +446,45 @@ public:
   constexpr std::string program_name() const { return m_program_name; }
   constexpr const GlobalRunStats &global_stats() const { return m_global; }
   constexpr const std::vector<Game> &all_games() const { return m_games; }
+  // Empty for the games played with stats_only
+  History::View guesses_of(Game const &game) const {
+    return m_history.view(game.guesses);
+  }
+  std::span<const ShipPlacement> ships_of(Game const &game) const {
+    return std::span{m_ships}.subspan(game.ships, game.ship_count);
+  }
+  // A walk over the ships of the game, for drawing boards
+  std::size_t ship_size_at(Game const &game, std::size_t row,
+                           std::size_t col) const {
+    for (auto const &ship : ships_of(game)) {
+      if (ship.covers(row, col))
+        return ship.size;
+    }
+    return 0;
+  }
+  bool board_drawable() const noexcept {
+    return m_layout.nbrRows.size <= max_drawn_side &&
+           m_layout.nbrCols.size <= max_drawn_side;
+  }
+  constexpr bool stats_only() const noexcept { return m_stats_only; }
   const battleship::GameLayout layout() const { return m_layout; }
   // Private Methods
 private:
-  void calculate_stats(Game &g);
-  VirtualGames::ShipHits make_hits_component(battleship::Ships const &ships);
+  void calculate_stats(VirtualStats &stats);
+  void store(PlayedGame const &game);
+  std::size_t nbr_cells() const noexcept {
+    return static_cast<std::size_t>(m_layout.nbrRows.size) *
+           m_layout.nbrCols.size;
+  }
+  bool dense() const noexcept {
+    return nbr_cells() <= max_dense_cells && m_layout.maxShipSize.size <= 255;
+  }
+  // Specialised on the BoardState of the game, picked by new_game
+  template <class State>
+  GuessResult apply_guess(const battleship::RowCol guess, TimeT elapsed_time);
+  // Writes value, or the size of the ship, on every cell of ships
+  void mark_board(std::span<const ShipPlacement> ships,
+                  std::optional<std::uint8_t> value = {});
 
   // Private Data
 private:
@@ -207,8 +492,27 @@ private:
   std::string m_program_name{};
   battleship::GameLayout m_layout;
 
-  Game m_current;
+  bool m_stats_only{false};
+  std::size_t m_warmup_games{0};
+
+  PlayedGame m_current;
+  ShipIndex m_index; // Ships of m_current
+  // Ship size per cell of m_current, only for boards of max_dense_cells
+  std::vector<std::uint8_t> m_board;
+  BoardState m_state; // Shots of m_current
+  GuessResult (VirtualGames::*m_apply)(const battleship::RowCol,
+                                       TimeT){nullptr};
+  bool m_all_sunk{false};
+  bool m_placed{true}; // The ships of m_current found room on the board
+  // Invalid guesses of m_current, searched for repeats
+  std::vector<battleship::RowCol> m_invalid;
+  // Ships of m_current hit but not sunk, gives the phase of the next guess
+  std::vector<bool> m_damaged;
+  std::size_t m_damaged_count{0};
+  bool m_any_hit{false};
   GlobalRunStats m_global;
   std::vector<Game> m_games;
+  History m_history;
+  std::vector<ShipPlacement> m_ships; // Ships of m_games
   std::chrono::high_resolution_clock::time_point m_guess_time;
 };
@@ -0,0 +1,166 @@
+#include "aicache.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace {
+
+// First line of the cache file, files without it are ignored
+constexpr std::string_view header{"tester03-aicache 2"};
+
+// One line per program: {size} {mtime} {hash} {nbrAi} {absolute path}
+struct Entry {
+  std::uintmax_t size{0};
+  std::int64_t mtime{0}; // Ticks of std::filesystem::file_time_type
+  std::uint64_t hash{0};
+  std::size_t nbrAi{0};
+  std::string program;
+};
+
+std::filesystem::path cache_file() {
+  std::filesystem::path dir;
+  if (auto xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+    dir = xdg;
+  else if (auto home = std::getenv("HOME"); home && *home)
+    dir = std::filesystem::path(home) / ".cache";
+  else
+    return {};
+  return dir / "tester03" / "ai_count";
+}
+
+// Path, size and modification time of the program, the hash left at 0
+std::optional<Entry> stat_program(std::string const &program) {
+  std::error_code ec;
+  auto const path = std::filesystem::canonical(program, ec);
+  if (ec)
+    return {};
+  Entry entry;
+  entry.size = std::filesystem::file_size(path, ec);
+  if (ec)
+    return {};
+  auto const time = std::filesystem::last_write_time(path, ec);
+  if (ec)
+    return {};
+  entry.mtime = static_cast<std::int64_t>(time.time_since_epoch().count());
+  entry.program = path.string();
+  return entry;
+}
+
+// FNV-1a of the file contents
+std::optional<std::uint64_t> binary_hash(std::string const &program) {
+  std::ifstream file{program, std::ios::binary};
+  if (!file)
+    return {};
+
+  std::uint64_t hash = 14695981039346656037ull;
+  std::vector<char> buffer(64 * 1024);
+  while (file.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) ||
+         file.gcount() > 0) {
+    for (std::streamsize index = 0; index < file.gcount(); ++index) {
+      hash ^= static_cast<unsigned char>(buffer[static_cast<std::size_t>(index)]);
+      hash *= 1099511628211ull;
+    }
+  }
+  return hash;
+}
+
+std::vector<Entry> read_entries(std::filesystem::path const &path) {
+  std::vector<Entry> entries;
+  std::ifstream file{path};
+  std::string line;
+  if (!std::getline(file, line) || line != header)
+    return entries;
+
+  Entry entry;
+  while (file >> entry.size >> entry.mtime >> entry.hash >> entry.nbrAi &&
+         std::getline(file >> std::ws, entry.program))
+    entries.push_back(entry);
+  return entries;
+}
+
+// Replaces the file at once, a run reading it meanwhile sees the old or the
+// new entries
+void write_entries(std::filesystem::path const &path,
+                   std::vector<Entry> const &entries) {
+  std::error_code ec;
+  std::filesystem::create_directories(path.parent_path(), ec);
+  if (ec)
+    return;
+
+  auto temp = path;
+  temp += ".tmp";
+  {
+    std::ofstream file{temp, std::ios::trunc};
+    file << header << '\n';
+    for (auto const &entry : entries)
+      file << entry.size << ' ' << entry.mtime << ' ' << entry.hash << ' '
+           << entry.nbrAi << ' ' << entry.program << '\n';
+    if (!file.flush())
+      return;
+  }
+  std::filesystem::rename(temp, path, ec);
+}
+
+// Overwrites the entry of the same program or adds one
+void update(std::vector<Entry> &entries, Entry const &entry) {
+  auto found = std::ranges::find(entries, entry.program, &Entry::program);
+  if (found != entries.end())
+    *found = entry;
+  else
+    entries.push_back(entry);
+}
+
+} // namespace
+
+namespace aicache {
+
+std::optional<std::size_t> lookup(std::string const &program) {
+  auto const path = cache_file();
+  auto stat = stat_program(program);
+  if (path.empty() || !stat)
+    return {};
+
+  auto entries = read_entries(path);
+  auto const known =
+      std::ranges::find(entries, stat->program, &Entry::program);
+  if (known != entries.end() && known->size == stat->size &&
+      known->mtime == stat->mtime)
+    return known->nbrAi;
+
+  // New, rebuilt, touched or copied: the contents decide
+  auto const hash = binary_hash(stat->program);
+  if (!hash)
+    return {};
+  auto const same = std::ranges::find(entries, hash.value(), &Entry::hash);
+  if (same == entries.end())
+    return {};
+
+  stat->hash = hash.value();
+  stat->nbrAi = same->nbrAi;
+  update(entries, stat.value());
+  write_entries(path, entries);
+  return stat->nbrAi;
+}
+
+void store(std::string const &program, std::size_t nbrAi) {
+  auto const path = cache_file();
+  auto stat = stat_program(program);
+  if (path.empty() || !stat)
+    return;
+  auto const hash = binary_hash(stat->program);
+  if (!hash)
+    return;
+
+  stat->hash = hash.value();
+  stat->nbrAi = nbrAi;
+  auto entries = read_entries(path);
+  update(entries, stat.value());
+  write_entries(path, entries);
+}
+
+} // namespace aicache
@@ -0,0 +1,27 @@
+#include "alloccount.hpp"
+#include <cstdlib>
+#include <new>
+
+namespace {
+thread_local std::size_t allocations{0};
+}
+
+std::size_t alloccount::thread_allocations() noexcept { return allocations; }
+
+#ifdef TESTER03_COUNT_ALLOCATIONS
+void *operator new(std::size_t size) {
+  ++allocations;
+  if (size == 0)
+    size = 1;
+  if (void *ptr = std::malloc(size))
+    return ptr;
+  throw std::bad_alloc{};
+}
+
+void *operator new[](std::size_t size) { return ::operator new(size); }
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+#endif
@@ -1,7 +1,16 @@
 #include "commandline.hpp"
+#include "RowCol.hpp"
 #include "clipp.h"
+#include "lineframer.hpp"
 #include "programoptions.hpp"
+#include <algorithm>
+#include <charconv>
+#include <format>
 #include <iostream>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <utility>
 
 namespace commandline {
 
@@ -12,7 +21,39 @@ ProgramOptions::Options parse(int argc, char *argv[]) {
   ProgramOptions::Options opt;
 
   auto match_report_type = [](const std::string &arg) {
-    return arg == "csv" || arg == "report";
+    return arg == "csv" || arg == "report" || arg == "journal";
+  };
+
+  auto set_report_type = [&](std::string const &value) {
+    if (value == "csv")
+      opt.filemode = ProgramOptions::FileOutput::csv;
+    else if (value == "journal")
+      opt.filemode = ProgramOptions::FileOutput::journal;
+    else
+      opt.filemode = ProgramOptions::FileOutput::report;
+  };
+
+  // "i/N" with i < N
+  auto parse_shard = [](const std::string &arg)
+      -> std::optional<std::pair<std::size_t, std::size_t>> {
+    std::size_t index{0};
+    std::size_t count{0};
+    auto const end = arg.data() + arg.size();
+    auto [slash, ec] = std::from_chars(arg.data(), end, index);
+    if (ec != std::errc{} || slash == end || *slash != '/')
+      return {};
+    auto [last, ec_count] = std::from_chars(slash + 1, end, count);
+    if (ec_count != std::errc{} || last != end || index >= count)
+      return {};
+    return std::pair{index, count};
+  };
+
+  auto match_shard = [&](const std::string &arg) {
+    return parse_shard(arg).has_value();
+  };
+
+  auto match_engine = [](const std::string &arg) {
+    return arg == "threads" || arg == "epoll";
   };
 
   auto run_cli =
@@ -20,9 +61,11 @@ ProgramOptions::Options parse(int argc, char *argv[]) {
        (option("--iterations") & value("iterations", opt.nbrIterations) %
                                      "Number of games to test against the AI."),
        (option("--rows") &
-        value("rows", opt.rowSize) % "Number of rows. Default is 10."),
+        value("rows", opt.rowSize) %
+            "Number of rows, up to 65535. Default is 10."),
        (option("--cols") &
-        value("cols", opt.colSize) % "Number of cols. Default is 10."),
+        value("cols", opt.colSize) %
+            "Number of cols, up to 65535. Default is 10."),
        (option("--ships") &
         value("smallest ship", opt.smallestShip) %
             "Smallest ship default is 2" &
@@ -31,13 +74,8 @@ ProgramOptions::Options parse(int argc, char *argv[]) {
         value("report file", opt.result_file) %
             "Write results to a file. Default is results.txt"),
        (option("--fileformat") &
-        (value(match_report_type, "csv or filter")
-             .call([&](std::string const &value) {
-               if (value == "csv")
-                 opt.filemode = ProgramOptions::FileOutput::csv;
-               else
-                 opt.filemode = ProgramOptions::FileOutput::report;
-             }))),
+        (value(match_report_type, "csv, report or journal")
+             .call(set_report_type))),
        (option("--layout") &
         value("layout file", opt.ship_layout_file) %
             "Load a layout file to test non random ship placements"),
@@ -45,6 +83,81 @@ ProgramOptions::Options parse(int argc, char *argv[]) {
         value("wait time", opt.wait_upto_millis) %
             "Amount of time in killingseconds to wait for an answer before "
             "killing the testing program. Default is 500 ms. "),
+       (option("--budget") &
+        value("budget", opt.game_budget_millis) %
+            "Time in milliseconds the AI has for all the answers of one "
+            "game. Ends the game when used up. Default is no budget."),
+       (option("--increment") &
+        value("increment", opt.increment_millis) %
+            "Milliseconds added to the game budget after every answer given "
+            "in time. Default is 0."),
+       (option("--threads") &
+        value("threads", opt.max_threads) %
+            "Maximum number of AI instances to run at once. Iterations of one "
+            "AI are split across instances. Default is the number of cores."),
+       (option("--engine") &
+        (value(match_engine, "threads or epoll")
+             .call([&](std::string const &value) {
+               if (value == "epoll")
+                 opt.engine = ProgramOptions::Engine::epoll;
+               else
+                 opt.engine = ProgramOptions::Engine::threads;
+             })) %
+            "threads runs every AI instance on its own thread. epoll drives "
+            "all of them from a few event loop threads. Default is threads."),
+       (option("--loops") &
+        value("loops", opt.event_loops) %
+            "Number of event loop threads used by the epoll engine. Default "
+            "is 1."),
+       (option("--pin").set(opt.pin_cpus) %
+        "Pin each AI process and the thread driving it to a pair of CPUs "
+        "sharing a core or an L2 cache."),
+       (option("--shm").set(opt.shm_transport) %
+        "Talk to the AI over shared memory (run --ai N --shm NAME) instead "
+        "of pipes. Falls back to pipes when the AI does not attach. Needs "
+        "the threads engine, not with --games."),
+       (option("--line-per-reply").set(opt.line_per_reply) %
+        "The AI answers every reply with one line, the final S included "
+        "(run --ai N --line-per-reply). Lines of a game that ended are then "
+        "dropped by count instead of drained before the next game."),
+       (option("--games") &
+        value("games", opt.multiplex_games) %
+            "Number of games each AI process plays at once (run --ai N "
+            "--games K), lines are tagged with the game. Default is 1. Needs "
+            "the threads engine, not with --salvo or --shm."),
+       (option("--salvo") &
+        value("shots", opt.salvo_shots) %
+            "Salvo variant, the AI sends up to this many guesses per turn on "
+            "one line (run --ai N --salvo S) and gets one result per guess "
+            "back. Default is 1. A turn must fit on a line of 1024 bytes. "
+            "Needs the threads engine, not with --games."),
+       (option("--histogram").set(opt.display_histogram) %
+        "Add the answer time histogram of every AI to the report."),
+       (option("--warmup") &
+        value("games", opt.warmup_games) %
+            "Leave the first games of each AI instance out of the answer "
+            "time histograms and percentiles. Default is 0."),
+       (option("--baseline").set(opt.subtract_baseline) %
+        "After the run, play echo_ai on the same transport and show the "
+        "answer times without that harness cost."),
+       (option("--stats-only").set(opt.stats_only) %
+        "Keep the statistics of every game but none of its guesses or "
+        "boards. For long runs, the reports show no moves."),
+       (option("--shard") &
+        (value(match_shard, "i/N").call([&](std::string const &value) {
+          std::tie(opt.shard_index, opt.shard_count) =
+              parse_shard(value).value();
+        })) %
+            "Play shard i of N of the run: 1/N of the iterations, written as "
+            "a journal (results.shard{i}of{N}.journal unless -o is given). "
+            "Combine the shards with the merge command."),
+       (option("--plugin").set(opt.plugin) %
+        "The program is a shared library implementing aiplugin.h, the AIs "
+        "run inside the tester."),
+       (option("--reference").set(opt.reference_ais) %
+        "Also play the reference AIs built into the tester (random, "
+        "hunt/target and probability density) in process on the same "
+        "layout, shown next to the AIs of the program as a baseline."),
        repeatable((option("--ai") & value("ai id", opt.ai_id_to_test))),
        (value("program", opt.program_to_test) %
         "Executable program to test that follows Challenge03 protocol."));
@@ -54,7 +167,42 @@ ProgramOptions::Options parse(int argc, char *argv[]) {
   auto help_cli =
       (clipp::command("help").set(opt.mode, ProgramOptions::RunMode::help));
 
-  auto cli = run_cli | version_cli | help_cli;
+  auto merge_cli =
+      (clipp::command("merge").set(opt.mode, ProgramOptions::RunMode::merge),
+       (option("-o", "--output") &
+        value("report file", opt.result_file) %
+            "Write the merged results to a file instead of showing them"),
+       (option("--fileformat") &
+        (value(match_report_type, "csv, report or journal")
+             .call(set_report_type))),
+       (values("journal", opt.journal_files) %
+        "Journals written by run --shard, in any order."));
+
+  bool iterations_given{false};
+  auto calibrate_cli =
+      (clipp::command("calibrate")
+           .set(opt.mode, ProgramOptions::RunMode::calibrate),
+       (option("--iterations").set(iterations_given) &
+        value("iterations", opt.nbrIterations) %
+            "Games per echo_ai instance. Default is 200."),
+       (option("--threads") &
+        value("threads", opt.max_threads) %
+            "Highest number of instances measured, from 1 doubling up to it. "
+            "Default is the number of cores."),
+       (option("--games") &
+        value("games", opt.multiplex_games) %
+            "Games at once for the multiplexed transport. Default is 2."),
+       (option("--salvo") &
+        value("shots", opt.salvo_shots) % "Guesses per turn. Default is 1."),
+       (option("--pin").set(opt.pin_cpus) %
+        "Pin the instances as run --pin does."),
+       (option("--loops") &
+        value("loops", opt.event_loops) %
+            "Event loop threads for the epoll transport. Default is 1."),
+       (opt_value("echo program", opt.program_to_test) %
+        "AI to measure instead of the echo_ai built next to tester03."));
+
+  auto cli = run_cli | merge_cli | calibrate_cli | version_cli | help_cli;
 
   if (!parse(argc, argv, cli)) {
     std::cout << clipp::usage_lines(cli, "tester03") << '\n';
@@ -72,12 +220,86 @@ ProgramOptions::Options parse(int argc, char *argv[]) {
   else
     opt.all_ai = true;
 
+  if (opt.mode == ProgramOptions::RunMode::calibrate) {
+    if (!iterations_given)
+      opt.nbrIterations = 200;
+    return opt;
+  }
+
+  if (opt.mode == ProgramOptions::RunMode::merge) {
+    if (opt.journal_files.empty()) {
+      std::cout << clipp::usage_lines(cli, "tester03") << '\n'
+                << "Missing journals to merge.\n";
+      opt.mode = ProgramOptions::RunMode::error;
+    }
+    return opt;
+  }
+
+  // A shard always ends up in a journal for merge to read
+  if (opt.shard_count > 1) {
+    opt.filemode = ProgramOptions::FileOutput::journal;
+    if (opt.result_file == "")
+      opt.result_file = std::format("results.shard{}of{}.journal",
+                                    opt.shard_index, opt.shard_count);
+  }
+
   if (opt.program_to_test == "") {
     std::cout << clipp::usage_lines(cli, "tester03") << '\n'
               << "Missing program to test.\n";
     opt.mode = ProgramOptions::RunMode::error;
   }
 
+  // Rows, columns and ship sizes are 16 bit on the board and in the moves
+  constexpr std::size_t max_side = 65535;
+  if (opt.rowSize == 0 || opt.colSize == 0 || opt.rowSize > max_side ||
+      opt.colSize > max_side || opt.smallestShip > opt.largestShip ||
+      opt.largestShip > std::max(opt.rowSize, opt.colSize)) {
+    std::cout << "Boards go from 1x1 to 65535x65535 and the largest ship "
+                 "must fit on the board.\n";
+    opt.mode = ProgramOptions::RunMode::error;
+  }
+
+  // A salvo turn is one line read through the LineFramer. Every guess is at
+  // most as long as the one for the last cell, the line ends with "\r\n".
+  if (opt.salvo_shots > 1 && opt.mode != ProgramOptions::RunMode::error) {
+    auto const guess =
+        battleship::RowCol{
+            battleship::Row{
+                static_cast<battleship::Row::type>(opt.rowSize - 1)},
+            battleship::Col{
+                static_cast<battleship::Col::type>(opt.colSize - 1)}}
+            .as_base26_fmt()
+            .size();
+    auto const max_shots = (LineFramer::capacity - 2) / (guess + 1);
+    if (opt.salvo_shots > max_shots) {
+      std::cout << std::format("--salvo is at most {} on this board, a turn "
+                               "must fit on a line of {} bytes.\n",
+                               max_shots, LineFramer::capacity);
+      opt.mode = ProgramOptions::RunMode::error;
+    }
+  }
+
+  // Refused rather than left out silently by the engine that plays the run
+  bool const games = opt.multiplex_games > 1;
+  bool const salvo = opt.salvo_shots > 1;
+  std::string_view conflict;
+  if (opt.plugin && (games || salvo || opt.shm_transport ||
+                     opt.engine == ProgramOptions::Engine::epoll))
+    conflict = "--plugin plays the AIs in process, it cannot be combined "
+               "with --games, --salvo, --shm or --engine epoll.";
+  else if (opt.engine == ProgramOptions::Engine::epoll &&
+           (games || salvo || opt.shm_transport))
+    conflict = "--engine epoll plays one game per process over pipes, "
+               "--games, --salvo and --shm need --engine threads.";
+  else if (games && salvo)
+    conflict = "--games and --salvo cannot be combined.";
+  else if (games && opt.shm_transport)
+    conflict = "--games plays over pipes, it cannot be combined with --shm.";
+  if (!conflict.empty()) {
+    std::cout << conflict << '\n';
+    opt.mode = ProgramOptions::RunMode::error;
+  }
+
   return opt;
 }
 } // namespace commandline
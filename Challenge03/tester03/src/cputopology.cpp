@@ -0,0 +1,108 @@
+#include "cputopology.hpp"
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <set>
+#include <string>
+#include <string_view>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace {
+
+const std::string cpu_root = "/sys/devices/system/cpu/";
+
+// Parses the kernel cpu list format, for example "0-3,8,10-11"
+std::vector<int> parse_cpu_list(std::string_view text) {
+  std::vector<int> cpus;
+  while (!text.empty()) {
+    auto const comma = text.find(',');
+    auto const item = text.substr(0, comma);
+    text = comma == std::string_view::npos ? std::string_view{}
+                                           : text.substr(comma + 1);
+
+    int first{0};
+    auto [ptr, ec] = std::from_chars(item.data(), item.data() + item.size(),
+                                     first);
+    if (ec != std::errc{})
+      continue;
+    int last = first;
+    if (ptr != item.data() + item.size() && *ptr == '-')
+      std::from_chars(ptr + 1, item.data() + item.size(), last);
+
+    for (int cpu = first; cpu <= last; ++cpu)
+      cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+std::vector<int> read_cpu_list(std::string const &path) {
+  std::ifstream file{path};
+  std::string line;
+  if (!std::getline(file, line))
+    return {};
+  return parse_cpu_list(line);
+}
+
+} // namespace
+
+namespace cputopology {
+
+std::vector<CpuPair> sibling_pairs() {
+  auto const online = read_cpu_list(cpu_root + "online");
+  std::set<int> unused{online.begin(), online.end()};
+  std::vector<CpuPair> pairs;
+
+  // Pairs cpu with the first unused CPU of the list, if any
+  auto pair_from = [&](int cpu, std::string const &list) {
+    for (int other : read_cpu_list(list)) {
+      if (other != cpu && unused.contains(other)) {
+        pairs.push_back({cpu, other});
+        unused.erase(cpu);
+        unused.erase(other);
+        return;
+      }
+    }
+  };
+
+  for (int cpu : online) {
+    if (unused.contains(cpu))
+      pair_from(cpu, cpu_root + "cpu" + std::to_string(cpu) +
+                         "/topology/thread_siblings_list");
+  }
+  for (int cpu : online) {
+    if (unused.contains(cpu))
+      pair_from(cpu, cpu_root + "cpu" + std::to_string(cpu) +
+                         "/cache/index2/shared_cpu_list");
+  }
+
+  // No close neighbour left, pair the rest in order
+  while (unused.size() >= 2) {
+    int runner = *unused.begin();
+    unused.erase(unused.begin());
+    int ai = *unused.begin();
+    unused.erase(unused.begin());
+    pairs.push_back({runner, ai});
+  }
+  if (!unused.empty())
+    pairs.push_back({*unused.begin(), *unused.begin()});
+
+  return pairs;
+}
+
+bool pin_current_thread(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0;
+}
+
+bool pin_process(int pid, int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return ::sched_setaffinity(pid, sizeof(set), &set) == 0;
+}
+
+} // namespace cputopology
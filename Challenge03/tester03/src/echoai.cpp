@@ -0,0 +1,204 @@
+/***
+ * @description echo_ai, the AI used by `tester03 calibrate`. It plays by the
+ * Challenge03 protocol but does no thinking: every answer from the tester is
+ * replied to at once with the next cell of a row by row sweep of the board.
+ * The time the tester measures for it is the cost of the tester itself:
+ * pipes or shared memory, poll and the bookkeeping of a move.
+ *
+ * Supports --games (several games at once) and --salvo, and --shm when given,
+ * so every transport of the tester can be measured.
+ * */
+
+#include "RowCol.hpp"
+#include "shmring.hpp"
+#include <charconv>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+struct Settings {
+  std::size_t rows{10};
+  std::size_t cols{10};
+  std::size_t games{1};
+  std::size_t salvo{1};
+  std::string shm_name{};
+};
+
+std::size_t to_size(std::string_view text, std::size_t fallback) {
+  std::size_t value{0};
+  auto [ptr, ec] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  return ec == std::errc{} && value > 0 ? value : fallback;
+}
+
+class Echo {
+public:
+  explicit Echo(Settings const &settings)
+      : m_settings(settings), m_sweep(settings.games, 0) {}
+
+  // Appends the reply to line to out. False once the tester sent Q.
+  bool answer(std::string_view line, std::string &out) {
+    if (!line.empty() && line.back() == '\r')
+      line.remove_suffix(1);
+
+    std::size_t slot{0};
+    if (m_settings.games > 1 && line != "Q") {
+      auto const space = line.find(' ');
+      if (space == std::string_view::npos)
+        return true;
+      slot = to_size(line.substr(0, space), 0);
+      if (slot >= m_sweep.size())
+        return true;
+      out.append(line.substr(0, space + 1));
+      line.remove_prefix(space + 1);
+    }
+
+    if (line.empty() || line.front() == 'Q')
+      return false;
+    if (line.front() == 'E')
+      m_sweep[slot] = 0;
+
+    auto const cells = m_settings.rows * m_settings.cols;
+    for (std::size_t shot = 0; shot < m_settings.salvo; ++shot) {
+      auto const cell = m_sweep[slot]++ % cells;
+      if (shot > 0)
+        out.push_back(' ');
+      out.append(battleship::RowCol{
+          battleship::Row{static_cast<battleship::Row::type>(
+              cell / m_settings.cols)},
+          battleship::Col{static_cast<battleship::Col::type>(
+              cell % m_settings.cols)}}
+                     .as_base26_fmt());
+    }
+    out.push_back('\n');
+    return true;
+  }
+
+  // Answers every complete line in buffer, keeps the rest for the next read
+  bool answer_lines(std::string &buffer, std::string &out) {
+    std::size_t start{0};
+    bool playing = true;
+    for (auto end = buffer.find('\n'); end != std::string::npos && playing;
+         end = buffer.find('\n', start)) {
+      playing =
+          answer(std::string_view{buffer}.substr(start, end - start), out);
+      start = end + 1;
+    }
+    buffer.erase(0, start);
+    return playing;
+  }
+
+private:
+  Settings m_settings;
+  std::vector<std::size_t> m_sweep; // Next cell of each game
+};
+
+bool write_all(int fd, std::string_view text) {
+  while (!text.empty()) {
+    auto const written = ::write(fd, text.data(), text.size());
+    if (written <= 0)
+      return false;
+    text.remove_prefix(static_cast<std::size_t>(written));
+  }
+  return true;
+}
+
+int play_pipes(Echo &echo) {
+  std::string buffer;
+  std::string out;
+  char chunk[4096];
+  while (true) {
+    auto const bytes = ::read(STDIN_FILENO, chunk, sizeof(chunk));
+    if (bytes <= 0)
+      return 0;
+    buffer.append(chunk, static_cast<std::size_t>(bytes));
+    out.clear();
+    bool const playing = echo.answer_lines(buffer, out);
+    // One write for everything read at once
+    if (!write_all(STDOUT_FILENO, out) || !playing)
+      return 0;
+  }
+}
+
+int play_shm(Echo &echo, std::string const &name) {
+  int fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+  if (fd < 0)
+    return play_pipes(echo);
+  void *memory = ::mmap(nullptr, sizeof(shm::Channel), PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (memory == MAP_FAILED)
+    return play_pipes(echo);
+
+  auto *channel = static_cast<shm::Channel *>(memory);
+  channel->attached.store(1, std::memory_order_release);
+  shm::futex_wake(&channel->attached);
+
+  std::string buffer;
+  std::string out;
+  char chunk[shm::Ring::capacity];
+  bool playing = true;
+  while (playing) {
+    // The tester quits with Q, a long silence means it is gone
+    if (!channel->to_ai.wait_readable(std::chrono::seconds(10)))
+      break;
+    while (channel->to_ai.readable()) {
+      auto const bytes = channel->to_ai.read(chunk, sizeof(chunk));
+      buffer.append(chunk, bytes);
+    }
+    out.clear();
+    playing = echo.answer_lines(buffer, out);
+    std::string_view pending{out};
+    while (!pending.empty() &&
+           channel->from_ai.wait_writable(std::chrono::seconds(10)))
+      pending.remove_prefix(channel->from_ai.write(pending));
+  }
+  ::munmap(memory, sizeof(shm::Channel));
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::vector<std::string_view> args(argv + 1, argv + argc);
+  if (args.empty())
+    return 1;
+
+  if (args[0] == "ai") {
+    if (args.size() > 1 && args[1] == "--details")
+      std::puts("0: Echo, sweeps the board row by row and answers at once");
+    else
+      std::puts("1");
+    return 0;
+  }
+  if (args[0] != "run")
+    return 1;
+
+  Settings settings;
+  for (std::size_t index = 1; index + 1 < args.size(); ++index) {
+    auto const value = args[index + 1];
+    if (args[index] == "--rows")
+      settings.rows = to_size(value, settings.rows);
+    else if (args[index] == "--cols")
+      settings.cols = to_size(value, settings.cols);
+    else if (args[index] == "--games")
+      settings.games = to_size(value, settings.games);
+    else if (args[index] == "--salvo")
+      settings.salvo = to_size(value, settings.salvo);
+    else if (args[index] == "--shm")
+      settings.shm_name = std::string{value};
+  }
+
+  Echo echo{settings};
+  if (!settings.shm_name.empty())
+    return play_shm(echo, settings.shm_name);
+  return play_pipes(echo);
+}
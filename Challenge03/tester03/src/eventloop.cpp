@@ -0,0 +1,728 @@
+#include "eventloop.hpp"
+#include "alloccount.hpp"
+#include "lineframer.hpp"
+#include "processwatch.hpp"
+#include "responsetable.hpp"
+#include "ship.hpp"
+#include "timecontrol.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+namespace {
+using SteadyClock = std::chrono::steady_clock;
+
+void close_fd(int &fd) {
+  if (fd >= 0)
+    ::close(fd);
+  fd = -1;
+}
+
+bool set_non_blocking(int fd) {
+  int flags = ::fcntl(fd, F_GETFL);
+  return flags >= 0 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Output kept free before handling a guess: its reply, the "E" of the next
+// game and the "E" of a game the deadline ends while the AI is not reading
+constexpr std::size_t reply_room = 16;
+} // namespace
+
+// One AI process and the game it is currently playing. Only touched by the
+// event loop that owns it, apart from the atomics used for progress.
+struct EventLoopRunner::Session {
+  // settling: the AI broke its pipes, the loop waits on the timer to see
+  // whether it crashed instead of blocking on its pidfd
+  enum class State { starting, playing, settling, finished };
+
+  // What an epoll event is for: the AI output, the move deadline or room in
+  // the AI input
+  struct Source {
+    enum class Kind { input, timer, output };
+    Session *session;
+    Kind kind;
+  };
+
+  VirtualGames game;
+  std::size_t iterations{0};
+  // Ending of the game when the AI turns out not to have crashed
+  VirtualGames::EndingState pipe_error{VirtualGames::EndingState::other};
+  TimeControl clock{};
+
+  pid_t pid{-1};
+  int ai_cpu{-1};
+  ProcessWatch watch{};
+  int to_app{-1};
+  int from_app{-1};
+  int epoll{-1};
+  int timer{-1}; // timerfd armed with the deadline of the current move
+  Source input_source{this, Source::Kind::input};
+  Source timer_source{this, Source::Kind::timer};
+  Source output_source{this, Source::Kind::output};
+
+  State state{State::starting};
+  LineFramer framer{};
+  ResponseTable responses{};
+  OutputBuffer out{};
+  // The AI input pipe is full. Its guesses wait until it reads its replies.
+  bool waiting_writable{false};
+  std::size_t guess_count{0};
+  RawClock::time_point last_read{}; // Taken right after each read
+
+  std::atomic<std::size_t> round{0};
+  std::atomic<bool> completed{false};
+
+  ~Session() {
+    close_fd(to_app);
+    close_fd(from_app);
+    close_fd(timer);
+  }
+
+  bool initalize_app();
+  bool create_timer();
+  void arm_timer();
+  void set_timer(TimeControl::Duration wait);
+  void start(int epoll_fd);
+  void on_readable();
+  void on_writable();
+  void wait_writable(bool wait);
+  void on_timer();
+  void on_deadline(RawClock::time_point now);
+  void record_budget();
+  void fail_remaining(VirtualGames::EndingState ending);
+  void on_app_error(VirtualGames::EndingState ending);
+  void on_settled();
+  void restart_after_crash();
+  void stop_watching_app();
+  void close_app();
+
+  void drain();
+  void process_input();
+  bool handle_line(std::string_view line);
+  bool end_test(VirtualGames::EndingState ending);
+  void begin_test();
+  void sunk_ship(battleship::ShipDefinition const shipdef);
+  void hit_ship();
+  void miss_ship();
+  void send_quit();
+  void respond(std::string_view text);
+  void flush();
+  void finish();
+};
+
+bool EventLoopRunner::Session::initalize_app() {
+  int in_pipe[2];  // AI stdin
+  int out_pipe[2]; // AI stdout
+  if (::pipe2(in_pipe, O_CLOEXEC) != 0)
+    return false;
+  if (::pipe2(out_pipe, O_CLOEXEC) != 0) {
+    ::close(in_pipe[0]);
+    ::close(in_pipe[1]);
+    return false;
+  }
+
+  posix_spawn_file_actions_t actions;
+  ::posix_spawn_file_actions_init(&actions);
+  ::posix_spawn_file_actions_adddup2(&actions, in_pipe[0], STDIN_FILENO);
+  ::posix_spawn_file_actions_adddup2(&actions, out_pipe[1], STDOUT_FILENO);
+  // Nobody reads stderr, a chatty AI must not block on a full pipe
+  ::posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null",
+                                     O_WRONLY, 0);
+
+  std::string program = game.program_name();
+  std::string run = "run";
+  std::string ai = "--ai";
+  std::string id = std::to_string(game.aiid());
+  std::string line_per_reply = "--line-per-reply";
+  std::array<char *, 6> argv{program.data(), run.data(), ai.data(), id.data(),
+                             nullptr, nullptr};
+  if (framer.line_per_reply())
+    argv[4] = line_per_reply.data();
+
+  int ec = ::posix_spawnp(&pid, program.c_str(), &actions, nullptr,
+                          argv.data(), environ);
+  ::posix_spawn_file_actions_destroy(&actions);
+  ::close(in_pipe[0]);
+  ::close(out_pipe[1]);
+
+  if (ec != 0) {
+    pid = -1;
+    ::close(in_pipe[1]);
+    ::close(out_pipe[0]);
+    return false;
+  }
+
+  to_app = in_pipe[1];
+  from_app = out_pipe[0];
+  watch = ProcessWatch{pid};
+  if (ai_cpu >= 0)
+    cputopology::pin_process(pid, ai_cpu);
+  if (!set_non_blocking(to_app) || !set_non_blocking(from_app))
+    return false;
+
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.ptr = &input_source;
+  return ::epoll_ctl(epoll, EPOLL_CTL_ADD, from_app, &event) == 0;
+}
+
+// timerfd has no CLOCK_MONOTONIC_RAW, it is armed with the time left and
+// on_deadline checks the deadline against the raw clock when it fires
+bool EventLoopRunner::Session::create_timer() {
+  timer = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (timer < 0)
+    return false;
+
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.ptr = &timer_source;
+  return ::epoll_ctl(epoll, EPOLL_CTL_ADD, timer, &event) == 0;
+}
+
+void EventLoopRunner::Session::arm_timer() {
+  set_timer(clock.remaining(RawClock::now()));
+}
+
+// Duration::max() disarms the timer
+void EventLoopRunner::Session::set_timer(TimeControl::Duration wait) {
+  itimerspec spec{}; // All zero disarms it
+  if (wait != TimeControl::Duration::max()) {
+    // Zero would disarm it, a deadline already reached fires right away
+    wait = std::max(wait, TimeControl::Duration{1});
+    auto const seconds = std::chrono::floor<std::chrono::seconds>(wait);
+    spec.it_value.tv_sec = static_cast<time_t>(seconds.count());
+    spec.it_value.tv_nsec = static_cast<long>((wait - seconds).count());
+  }
+  ::timerfd_settime(timer, 0, &spec, nullptr);
+}
+
+void EventLoopRunner::Session::start(int epoll_fd) {
+  epoll = epoll_fd;
+  round.store(0);
+  if (!create_timer() || !initalize_app()) {
+    finish();
+    return;
+  }
+
+  if (iterations == 0) {
+    finish();
+    return;
+  }
+
+  state = State::playing;
+  begin_test();
+}
+
+void EventLoopRunner::Session::on_readable() {
+  while (state == State::playing && !waiting_writable) {
+    auto area = framer.write_area();
+    auto bytes = ::read(from_app, area.data(), area.size());
+    if (bytes > 0) {
+      last_read = RawClock::now();
+      framer.commit(static_cast<std::size_t>(bytes));
+      process_input();
+      continue;
+    }
+    if (bytes < 0 && errno == EINTR)
+      continue;
+    if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      return;
+
+    // The AI closed its output
+    on_app_error(VirtualGames::EndingState::unable_read_output);
+    return;
+  }
+}
+
+void EventLoopRunner::Session::on_writable() {
+  flush();
+  if (state == State::playing && !waiting_writable)
+    process_input();
+}
+
+// Swaps reading guesses for waiting on room in the AI input and back. The
+// AI output leaves the epoll set meanwhile, it would report ready forever.
+void EventLoopRunner::Session::wait_writable(bool wait) {
+  if (wait == waiting_writable)
+    return;
+  waiting_writable = wait;
+
+  epoll_event output{};
+  output.events = EPOLLOUT;
+  output.data.ptr = &output_source;
+  ::epoll_ctl(epoll, wait ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, to_app, &output);
+
+  epoll_event input{};
+  input.events = EPOLLIN;
+  input.data.ptr = &input_source;
+  ::epoll_ctl(epoll, wait ? EPOLL_CTL_DEL : EPOLL_CTL_ADD, from_app, &input);
+}
+
+void EventLoopRunner::Session::on_timer() {
+  std::uint64_t expirations{0};
+  [[maybe_unused]] auto ignored =
+      ::read(timer, &expirations, sizeof(expirations));
+  if (state == State::settling)
+    on_settled();
+  else
+    on_deadline(RawClock::now());
+}
+
+void EventLoopRunner::Session::on_deadline(RawClock::time_point now) {
+  if (state != State::playing)
+    return;
+  if (now < clock.deadline()) {
+    // The timer clock ran ahead of the raw clock
+    arm_timer();
+    return;
+  }
+  clock.answered(now);
+  record_budget();
+  end_test(VirtualGames::EndingState::timeout);
+}
+
+void EventLoopRunner::Session::record_budget() {
+  if (clock.has_budget())
+    game.record_budget_left(
+        std::chrono::duration_cast<VirtualGames::TimeT>(clock.budget_left()));
+}
+
+// Handles every buffered guess. The first one may have arrived after the
+// previous answer, the following ones were sent before it (early guesses).
+// Stops while the AI does not read its replies, on_writable resumes.
+void EventLoopRunner::Session::process_input() {
+  bool early = false;
+  while (true) {
+    if (out.room() < reply_room)
+      flush();
+    if (waiting_writable)
+      return;
+    auto line = framer.next_line();
+    if (!line)
+      break;
+    if (early)
+      game.early_guess();
+    // When a game ends the framer drops the rest, it is stale
+    if (!handle_line(line.value()))
+      return;
+    early = true;
+  }
+
+  // Full without a single line, the AI is not following the protocol
+  if (framer.full())
+    end_test(VirtualGames::EndingState::unable_read_output);
+}
+
+// Same steps as TestRunner::read_app and the checks of TestRunner::run_test.
+// Returns false when the line ended the game.
+bool EventLoopRunner::Session::handle_line(std::string_view line) {
+  if (!line.empty() && line.front() == '-')
+    return end_test(VirtualGames::EndingState::program_has_no_guesses);
+
+  bool const in_time = clock.answered(last_read);
+  record_budget();
+  if (!in_time)
+    return end_test(VirtualGames::EndingState::timeout);
+
+  // Counted when built with TESTER03_COUNT_ALLOCATIONS
+  alloccount::Scope allocations;
+  auto result = game.guess(battleship::RowCol::from_string(line));
+  switch (result.report) {
+  case VirtualGames::GuessReport::Hit:
+    hit_ship();
+    break;
+  case VirtualGames::GuessReport::Sink:
+    sunk_ship(result.ship);
+    break;
+  case VirtualGames::GuessReport::Miss:
+    miss_ship();
+    break;
+  }
+  game.count_move_allocations(allocations.count());
+
+  if (++guess_count > game.max_guesses())
+    return end_test(VirtualGames::EndingState::too_many_guess);
+  if (game.sunk_all_ships())
+    return end_test(VirtualGames::EndingState::sunk_all_ships);
+
+  arm_timer();
+  return true;
+}
+
+bool EventLoopRunner::Session::end_test(VirtualGames::EndingState ending) {
+  game.end_game(ending);
+  if (round.load() + 1 < iterations) {
+    round.store(round.load() + 1);
+    begin_test();
+  } else {
+    finish();
+  }
+  return false;
+}
+
+// Drops what the AI wrote for the game that ended, without waiting for lines
+// it may still send. Only for an AI that does not answer every reply, the
+// framer counts the lines of the others.
+void EventLoopRunner::Session::drain() {
+  while (true) {
+    framer.start_game();
+    auto area = framer.write_area();
+    if (area.empty())
+      return;
+    auto bytes = ::read(from_app, area.data(), area.size());
+    if (bytes < 0 && errno == EINTR)
+      continue;
+    // Nothing more for now, or an error on_readable finds next
+    if (bytes <= 0)
+      return;
+    framer.commit(static_cast<std::size_t>(bytes));
+  }
+}
+
+void EventLoopRunner::Session::begin_test() {
+  // Whatever the AI still sends for the last game is dropped
+  if (!framer.line_per_reply())
+    drain();
+  framer.start_game();
+  guess_count = 0;
+  game.new_game();
+  respond(responses.new_game());
+  framer.reply_sent();
+  game.start_guess_timer();
+  clock.start_game();
+  record_budget();
+  arm_timer();
+}
+
+void EventLoopRunner::Session::sunk_ship(
+    battleship::ShipDefinition const shipdef) {
+  respond(responses.sunk(shipdef));
+  framer.reply_sent();
+  game.start_guess_timer();
+  clock.start_move();
+}
+
+void EventLoopRunner::Session::hit_ship() {
+  respond(responses.hit());
+  framer.reply_sent();
+  game.start_guess_timer();
+  clock.start_move();
+}
+
+void EventLoopRunner::Session::miss_ship() {
+  respond(responses.miss());
+  framer.reply_sent();
+  game.start_guess_timer();
+  clock.start_move();
+}
+
+void EventLoopRunner::Session::send_quit() {
+  // Best effort with whatever is still pending, the AI may already be gone
+  if (to_app < 0)
+    return;
+  respond(responses.quit());
+  [[maybe_unused]] auto ignored =
+      ::write(to_app, out.view().data(), out.view().size());
+  out.clear();
+}
+
+// Replies are collected while the loop handles a wake up and sent with one
+// write at the end of it
+void EventLoopRunner::Session::respond(std::string_view text) {
+  if (!out.append(text)) {
+    flush();
+    out.append(text);
+  }
+}
+
+void EventLoopRunner::Session::flush() {
+  while (state == State::playing && !out.empty()) {
+    auto written = ::write(to_app, out.view().data(), out.view().size());
+    if (written > 0) {
+      out.consume(static_cast<std::size_t>(written));
+      continue;
+    }
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // The pipe is full, the AI has not read its earlier replies yet. The
+      // move deadline still runs.
+      wait_writable(true);
+      return;
+    }
+
+    // The AI is gone (EPIPE) or the pipe failed
+    out.clear();
+    on_app_error(VirtualGames::EndingState::other);
+  }
+  if (state == State::playing)
+    wait_writable(false);
+}
+
+// A process that died is recorded as a crash and replaced. One that is alive
+// but broke its pipes would fail every game left the same way. A dying
+// process closes its pipes slightly before it exits: the other sessions of
+// the loop keep playing while the timer gives it ProcessWatch::settle_time.
+void EventLoopRunner::Session::on_app_error(VirtualGames::EndingState ending) {
+  if (watch.exited(std::chrono::milliseconds{0})) {
+    restart_after_crash();
+    return;
+  }
+  pipe_error = ending;
+  state = State::settling;
+  stop_watching_app();
+  set_timer(ProcessWatch::settle_time);
+}
+
+void EventLoopRunner::Session::on_settled() {
+  if (watch.exited(std::chrono::milliseconds{0})) {
+    restart_after_crash();
+  } else {
+    state = State::playing;
+    fail_remaining(pipe_error);
+  }
+}
+
+void EventLoopRunner::Session::restart_after_crash() {
+  game.end_game(VirtualGames::EndingState::crashed);
+
+  auto const start = VirtualGames::ClockT::now();
+  close_app();
+  if (round.load() + 1 >= iterations) {
+    finish();
+    return;
+  }
+
+  if (!initalize_app()) {
+    for (auto next = round.load() + 1; next < iterations; ++next) {
+      round.store(next);
+      game.new_game();
+      game.end_game(VirtualGames::EndingState::crashed);
+    }
+    close_app();
+    finish();
+    return;
+  }
+  game.record_restart(std::chrono::duration_cast<VirtualGames::TimeT>(
+      VirtualGames::ClockT::now() - start));
+
+  round.store(round.load() + 1);
+  state = State::playing;
+  begin_test();
+}
+
+// Takes the pipes of the AI out of the epoll set, they stay open
+void EventLoopRunner::Session::stop_watching_app() {
+  if (from_app >= 0)
+    ::epoll_ctl(epoll, EPOLL_CTL_DEL, from_app, nullptr);
+  if (to_app >= 0 && waiting_writable)
+    ::epoll_ctl(epoll, EPOLL_CTL_DEL, to_app, nullptr);
+  waiting_writable = false;
+}
+
+// Forgets the process and everything buffered for it. The process already
+// exited, reaping it does not block.
+void EventLoopRunner::Session::close_app() {
+  stop_watching_app();
+  close_fd(to_app);
+  close_fd(from_app);
+  watch = ProcessWatch{};
+  if (pid > 0)
+    ::waitpid(pid, nullptr, 0);
+  pid = -1;
+  framer.clear();
+  out.clear();
+}
+
+// Ends the current game and records every game left with the same ending so
+// the results have the requested number of games
+void EventLoopRunner::Session::fail_remaining(
+    VirtualGames::EndingState ending) {
+  game.end_game(ending);
+  for (auto next = round.load() + 1; next < iterations; ++next) {
+    round.store(next);
+    game.new_game();
+    game.end_game(ending);
+  }
+  finish();
+}
+
+// Every way a session ends goes through here, so the timer and the pipes
+// never stay in the epoll set of a finished session
+void EventLoopRunner::Session::finish() {
+  send_quit();
+  state = State::finished;
+  stop_watching_app();
+  if (timer >= 0)
+    ::epoll_ctl(epoll, EPOLL_CTL_DEL, timer, nullptr);
+  close_fd(to_app);
+  close_fd(from_app);
+  close_fd(timer);
+  framer.clear();
+  completed.store(true);
+}
+
+EventLoopRunner::EventLoopRunner(ProgramOptions::Options const &options,
+                                 std::vector<Shard> const &shards) {
+  m_sessions.reserve(shards.size());
+  for (auto const &shard : shards) {
+    auto session = std::make_unique<Session>();
+    session->game = VirtualGames(
+        options.program_to_test, shard.aiid,
+        {battleship::ShipDefinition{options.smallestShip},
+         battleship::ShipDefinition{options.largestShip},
+         battleship::Row{static_cast<battleship::Row::type>(options.rowSize)},
+         battleship::Col{static_cast<battleship::Col::type>(options.colSize)}},
+        options.stats_only, options.warmup_games);
+    session->responses = ResponseTable{session->game.layout()};
+    session->framer.set_line_per_reply(options.line_per_reply);
+    session->iterations = shard.iterations;
+    session->clock = TimeControl{TimeControl::from_options(options)};
+    m_sessions.push_back(std::move(session));
+  }
+}
+
+EventLoopRunner::~EventLoopRunner() { reap_all(); }
+
+void EventLoopRunner::run(std::size_t nbrLoops) {
+  // Writing to an AI that already exited must fail with EPIPE instead of
+  // ending the tester
+  std::signal(SIGPIPE, SIG_IGN);
+
+  nbrLoops = std::clamp<std::size_t>(nbrLoops, 1,
+                                     std::max<std::size_t>(1, size()));
+  {
+    std::vector<std::jthread> loops;
+    for (std::size_t loop = 0; loop < nbrLoops; ++loop)
+      loops.emplace_back(&EventLoopRunner::run_loop, this, loop, nbrLoops);
+  }
+  reap_all();
+}
+
+void EventLoopRunner::pin_to(std::vector<cputopology::CpuPair> pairs) {
+  m_cpus = std::move(pairs);
+}
+
+void EventLoopRunner::run_loop(std::size_t loop, std::size_t nbrLoops) {
+  std::vector<Session *> sessions;
+  for (std::size_t index = loop; index < m_sessions.size(); index += nbrLoops)
+    sessions.push_back(m_sessions[index].get());
+
+  if (!m_cpus.empty()) {
+    auto const &cpus = m_cpus[loop % m_cpus.size()];
+    cputopology::pin_current_thread(cpus.runner_cpu);
+    for (auto *session : sessions)
+      session->ai_cpu = cpus.ai_cpu;
+  }
+
+  int epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+  for (auto *session : sessions) {
+    session->start(epoll_fd);
+    session->flush();
+  }
+
+  // Every deadline has its own timer in the epoll set, no wait time to
+  // compute
+  std::array<epoll_event, 64> events;
+  while (std::ranges::any_of(sessions, [](Session const *session) {
+    return session->state != Session::State::finished;
+  })) {
+    int ready = ::epoll_wait(epoll_fd, events.data(),
+                             static_cast<int>(events.size()), -1);
+
+    if (ready < 0 && errno != EINTR) {
+      for (auto *session : sessions) {
+        if (session->state != Session::State::finished)
+          session->fail_remaining(VirtualGames::EndingState::other);
+      }
+      break;
+    }
+
+    for (int event = 0; event < ready; ++event) {
+      auto const *source =
+          static_cast<Session::Source const *>(events[event].data.ptr);
+      switch (source->kind) {
+      case Session::Source::Kind::input:
+        source->session->on_readable();
+        break;
+      case Session::Source::Kind::timer:
+        source->session->on_timer();
+        break;
+      case Session::Source::Kind::output:
+        source->session->on_writable();
+        break;
+      }
+    }
+
+    for (auto *session : sessions)
+      session->flush();
+  }
+
+  if (epoll_fd >= 0)
+    ::close(epoll_fd);
+}
+
+// Same stop sequence as default_process_options: give the AIs time to quit,
+// then terminate and finally kill the ones still running
+void EventLoopRunner::reap_all() {
+  auto wait_until = [this](SteadyClock::time_point until) {
+    while (true) {
+      bool all_done = true;
+      for (auto &session : m_sessions) {
+        if (session->pid <= 0)
+          continue;
+        auto result = ::waitpid(session->pid, nullptr, WNOHANG);
+        if (result == session->pid || result < 0)
+          session->pid = -1;
+        else
+          all_done = false;
+      }
+      if (all_done || SteadyClock::now() >= until)
+        return all_done;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  };
+
+  auto signal_all = [this](int sig) {
+    for (auto &session : m_sessions) {
+      if (session->pid > 0)
+        ::kill(session->pid, sig);
+    }
+  };
+
+  if (wait_until(SteadyClock::now() + std::chrono::milliseconds(1000)))
+    return;
+  signal_all(SIGTERM);
+  if (wait_until(SteadyClock::now() + std::chrono::milliseconds(5000)))
+    return;
+  signal_all(SIGKILL);
+  wait_until(SteadyClock::now() + std::chrono::milliseconds(2000));
+}
+
+std::size_t EventLoopRunner::current_round(std::size_t shard) const noexcept {
+  return m_sessions[shard]->round.load();
+}
+
+bool EventLoopRunner::is_completed(std::size_t shard) const noexcept {
+  return m_sessions[shard]->completed.load();
+}
+
+const VirtualGames &EventLoopRunner::games(std::size_t shard) const {
+  return m_sessions[shard]->game;
+}
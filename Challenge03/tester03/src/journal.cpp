@@ -0,0 +1,248 @@
+#include "journal.hpp"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string_view>
+
+namespace {
+constexpr std::string_view MAGIC = "tester03-journal";
+constexpr int VERSION = 1;
+
+void write_game(std::ostream &s, VirtualGames const &ai,
+                VirtualGames::Game const &game) {
+  s << "game " << static_cast<int>(game.ending_state) << ' '
+    << game.stats.invalid_guess_count << ' ' << game.stats.repeat_guess_count
+    << ' ' << game.stats.early_guess_count << ' '
+    << game.stats.move_allocations << ' ' << game.stats.turn_count << ' '
+    << game.stats.timed_budget << ' ' << game.stats.budget_left.count() << ' '
+    << game.stats.total_guess_count << ' ' << game.stats.total_time.count()
+    << ' ' << game.stats.shortest_answer.count() << ' '
+    << game.stats.longest_answer.count() << ' '
+    << game.stats.answer_times.mean() << ' ' << game.stats.answer_times.m2()
+    << ' ';
+  auto const ships = ai.ships_of(game);
+  s << ships.size();
+  for (auto const &ship : ships)
+    s << ' ' << ship.row << ' ' << ship.col << ' ' << ship.size << ' '
+      << ship.across;
+  s << '\n';
+
+  auto const guesses = ai.guesses_of(game);
+  s << "moves " << guesses.size();
+  for (auto const guess : guesses) {
+    s << ' ' << guess.guess.row.size << ' ' << guess.guess.col.size << ' '
+      << guess.elapsed_time.count() << ' ' << static_cast<int>(guess.result);
+  }
+  s << '\n';
+}
+
+// Only the buckets holding answers
+void write_latency(std::ostream &s, VirtualGames::Phase phase,
+                   LatencyHistogram const &histogram) {
+  if (histogram.count() == 0)
+    return;
+  std::size_t used{0};
+  for (std::size_t bucket = 0; bucket < LatencyHistogram::bucket_count;
+       ++bucket)
+    used += histogram.count(bucket) != 0;
+
+  s << "latency " << static_cast<int>(phase) << ' '
+    << histogram.min().count() << ' ' << histogram.max().count() << ' '
+    << used;
+  for (std::size_t bucket = 0; bucket < LatencyHistogram::bucket_count;
+       ++bucket) {
+    if (histogram.count(bucket) != 0)
+      s << ' ' << bucket << ' ' << histogram.count(bucket);
+  }
+  s << '\n';
+}
+
+bool read_latency(std::istream &s, VirtualGames &ai) {
+  int phase{0};
+  long long min{0}, max{0};
+  std::size_t used{0};
+  if (!(s >> phase >> min >> max >> used) || phase < 0 ||
+      phase >= static_cast<int>(VirtualGames::Phase_Count))
+    return false;
+  LatencyHistogram histogram;
+  for (std::size_t entry = 0; entry < used; ++entry) {
+    std::size_t bucket{0};
+    std::uint64_t count{0};
+    if (!(s >> bucket >> count))
+      return false;
+    histogram.add_count(bucket, count, LatencyHistogram::TimeT{min},
+                        LatencyHistogram::TimeT{max});
+  }
+  ai.restore_latency(static_cast<VirtualGames::Phase>(phase), histogram);
+  return true;
+}
+
+bool read_ships(std::istream &s, std::vector<ShipPlacement> &ships) {
+  std::size_t count{0};
+  if (!(s >> count))
+    return false;
+  ships.reserve(count);
+  for (std::size_t ship = 0; ship < count; ++ship) {
+    std::uint16_t row{0}, col{0}, size{0};
+    bool across{true};
+    if (!(s >> row >> col >> size >> across))
+      return false;
+    ships.push_back({row, col, size, across});
+  }
+  return true;
+}
+
+std::optional<VirtualGames::PlayedGame> read_game(std::istream &s) {
+  VirtualGames::PlayedGame game;
+  int ending{0};
+  long long budget_left{0};
+  s >> ending >> game.stats.invalid_guess_count >>
+      game.stats.repeat_guess_count >> game.stats.early_guess_count >>
+      game.stats.move_allocations >> game.stats.turn_count >>
+      game.stats.timed_budget >> budget_left;
+  // Games of a --stats-only run have no moves to count them from
+  long long total{0}, shortest{0}, longest{0};
+  double mean{0.0}, m2{0.0};
+  s >> game.stats.total_guess_count >> total >> shortest >> longest >> mean >>
+      m2;
+  game.stats.total_time = VirtualGames::TimeT{total};
+  game.stats.shortest_answer = VirtualGames::TimeT{shortest};
+  game.stats.longest_answer = VirtualGames::TimeT{longest};
+  // Recomputed from the moves when there are any
+  game.stats.answer_times =
+      RunningStats::from_moments(game.stats.total_guess_count, mean, m2);
+  if (!read_ships(s, game.ships) || ending < 0 ||
+      ending >= static_cast<int>(VirtualGames::EndingState_Count))
+    return {};
+  game.ending_state = static_cast<VirtualGames::EndingState>(ending);
+  game.stats.budget_left = VirtualGames::TimeT{budget_left};
+
+  std::string tag;
+  std::size_t count{0};
+  if (!(s >> tag >> count) || tag != "moves")
+    return {};
+  game.guesses.reserve(count);
+  for (std::size_t move = 0; move < count; ++move) {
+    unsigned short row{0};
+    unsigned short col{0};
+    long long elapsed{0};
+    int result{0};
+    if (!(s >> row >> col >> elapsed >> result))
+      return {};
+    game.guesses.push_back(
+        {battleship::RowCol{battleship::Row{row}, battleship::Col{col}},
+         VirtualGames::TimeT{elapsed},
+         static_cast<VirtualGames::Guess_Stats_Result>(result)});
+  }
+  return game;
+}
+} // namespace
+
+bool journal::write(std::string const &path, std::size_t shard_index,
+                    std::size_t shard_count,
+                    std::vector<VirtualGames> const &games) {
+  std::ofstream file{path, std::ios::trunc};
+  if (!file) {
+    std::cout << "Unable to open file for writing: " << path << '\n';
+    return false;
+  }
+
+  // Doubles read back to the same value
+  file << std::setprecision(std::numeric_limits<double>::max_digits10);
+  file << MAGIC << ' ' << VERSION << '\n';
+  file << "shard " << shard_index << ' ' << shard_count << '\n';
+  if (!games.empty()) {
+    auto const layout = games.front().layout();
+    file << "layout " << layout.nbrRows.size << ' ' << layout.nbrCols.size
+         << ' ' << layout.minShipSize.size << ' ' << layout.maxShipSize.size
+         << '\n';
+  }
+
+  for (auto const &ai : games) {
+    auto const &stats = ai.global_stats();
+    file << "ai " << ai.aiid() << ' ' << stats.restart_count << ' '
+         << stats.restart_time.count() << ' ' << stats.longest_restart.count()
+         << ' ' << ai.program_name() << '\n';
+    for (auto const &game : ai.all_games())
+      write_game(file, ai, game);
+    for (std::size_t phase = 0; phase < VirtualGames::Phase_Count; ++phase)
+      write_latency(file, static_cast<VirtualGames::Phase>(phase),
+                    stats.latency[phase]);
+    if (stats.harness.count() > 0)
+      file << "harness " << stats.harness.count() << ' '
+           << stats.harness.mean() << ' ' << stats.harness.m2() << '\n';
+    file << "end\n";
+  }
+  return static_cast<bool>(file);
+}
+
+std::optional<journal::Shard> journal::read(std::string const &path) {
+  std::ifstream file{path};
+  if (!file) {
+    std::cout << "Unable to open journal: " << path << '\n';
+    return {};
+  }
+
+  auto fail = [&path](std::string_view what) -> std::optional<Shard> {
+    std::cout << "Invalid journal " << path << ": " << what << '\n';
+    return {};
+  };
+
+  std::string magic;
+  int version{0};
+  if (!(file >> magic >> version) || magic != MAGIC || version != VERSION)
+    return fail("not a tester03 journal");
+
+  Shard shard;
+  battleship::GameLayout layout;
+  std::string tag;
+  while (file >> tag) {
+    if (tag == "shard") {
+      file >> shard.index >> shard.count;
+    } else if (tag == "layout") {
+      std::size_t rows{0}, cols{0}, smallest{0}, largest{0};
+      file >> rows >> cols >> smallest >> largest;
+      layout = battleship::GameLayout{
+          battleship::ShipDefinition{smallest},
+          battleship::ShipDefinition{largest},
+          battleship::Row{static_cast<battleship::Row::type>(rows)},
+          battleship::Col{static_cast<battleship::Col::type>(cols)}};
+    } else if (tag == "ai") {
+      AIID id{0};
+      std::size_t restarts{0};
+      long long restart_time{0}, longest_restart{0};
+      std::string program;
+      file >> id >> restarts >> restart_time >> longest_restart;
+      std::getline(file >> std::ws, program);
+      shard.games.emplace_back(program, id, layout);
+      shard.games.back().restore_restarts(
+          restarts, VirtualGames::TimeT{restart_time},
+          VirtualGames::TimeT{longest_restart});
+    } else if (tag == "game") {
+      if (shard.games.empty())
+        return fail("game before its ai");
+      auto game = read_game(file);
+      if (!game)
+        return fail("unreadable game");
+      shard.games.back().restore_game(std::move(game.value()));
+    } else if (tag == "latency") {
+      if (shard.games.empty() || !read_latency(file, shard.games.back()))
+        return fail("unreadable latency");
+    } else if (tag == "harness") {
+      std::size_t count{0};
+      double mean{0.0}, m2{0.0};
+      file >> count >> mean >> m2;
+      if (shard.games.empty())
+        return fail("harness before its ai");
+      shard.games.back().record_harness(
+          RunningStats::from_moments(count, mean, m2));
+    } else if (tag != "end") {
+      return fail("unknown record " + tag);
+    }
+    if (!file)
+      return fail("truncated record " + tag);
+  }
+  return shard;
+}
@@ -17,5 +17,10 @@ int main(int argc, char *argv[]) {
     return 0;
   case ProgramOptions::RunMode::test:
     test(opt);
+    break;
+  case ProgramOptions::RunMode::merge:
+    return merge(opt) ? 0 : 1;
+  case ProgramOptions::RunMode::calibrate:
+    return calibrate(opt) ? 0 : 1;
   }
 }
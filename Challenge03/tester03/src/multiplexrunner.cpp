@@ -0,0 +1,272 @@
+#include "multiplexrunner.hpp"
+#include "processpool.hpp"
+#include <algorithm>
+#include <charconv>
+#include <system_error>
+
+MultiplexRunner::MultiplexRunner(ProgramOptions::Options const &options,
+                                 AIID aiid, std::size_t nbrGames) {
+  nbrGames = std::max<std::size_t>(1, nbrGames);
+  battleship::GameLayout const layout{
+      battleship::ShipDefinition{options.smallestShip},
+      battleship::ShipDefinition{options.largestShip},
+      battleship::Row{static_cast<battleship::Row::type>(options.rowSize)},
+      battleship::Col{static_cast<battleship::Col::type>(options.colSize)}};
+
+  m_slots.resize(nbrGames);
+  for (std::size_t slot = 0; slot < nbrGames; ++slot) {
+    m_slots[slot].game = VirtualGames(options.program_to_test, aiid, layout,
+                                      options.stats_only, options.warmup_games);
+    m_slots[slot].clock = TimeControl{TimeControl::from_options(options)};
+    m_tags.push_back(std::to_string(slot) + ' ');
+  }
+  m_merged = VirtualGames(options.program_to_test, aiid, layout,
+                          options.stats_only, options.warmup_games);
+  m_responses = ResponseTable{layout};
+}
+
+MultiplexRunner::MultiplexRunner(MultiplexRunner &&other) noexcept
+    : m_slots(std::move(other.m_slots)), m_tags(std::move(other.m_tags)),
+      m_merged(std::move(other.m_merged)), m_app(std::move(other.m_app)),
+      m_watch(std::move(other.m_watch)), m_framer(other.m_framer),
+      m_responses(std::move(other.m_responses)), m_out(other.m_out),
+      m_cpus(other.m_cpus), m_last_read(other.m_last_read),
+      m_tagged(other.m_tagged), m_untagged(other.m_untagged) {
+  m_round.exchange(other.m_round);
+  m_completed.exchange(other.m_completed);
+}
+
+void MultiplexRunner::start_tests(std::size_t nbrIterations) {
+  if (m_cpus)
+    cputopology::pin_current_thread(m_cpus->runner_cpu);
+
+  m_round.store(0);
+  m_completed.store(false);
+  m_tagged = false;
+  m_untagged = false;
+  if (!initalize_app()) {
+    m_completed.store(true);
+    return;
+  }
+
+  for (std::size_t slot = 0; slot < m_slots.size(); ++slot) {
+    m_slots[slot].iterations = nbrIterations / m_slots.size() +
+                               (slot < nbrIterations % m_slots.size() ? 1 : 0);
+    if (m_slots[slot].iterations > 0)
+      begin_game(slot);
+  }
+
+  while (any_active()) {
+    flush();
+
+    auto const now = RawClock::now();
+    auto const until = next_deadline();
+    auto const remaining = reproc::milliseconds(TimeControl::poll_millis(
+        until > now ? until - now : TimeControl::Duration{0}));
+    if (remaining.count() > 0) {
+      auto event = m_app.poll(reproc::event::out, remaining);
+      if (event.second) {
+        fail_all(m_watch.exited() ? VirtualGames::EndingState::crashed
+                                  : VirtualGames::EndingState::other);
+        break;
+      }
+      if (event.first == reproc::event::out) {
+        auto area = m_framer.write_area();
+        auto [bytes_read, ec] = m_app.read(
+            reproc::stream::out, (unsigned char *)area.data(), area.size());
+        if (ec || bytes_read == 0) {
+          fail_all(m_watch.exited()
+                       ? VirtualGames::EndingState::crashed
+                       : VirtualGames::EndingState::unable_read_output);
+          break;
+        }
+        m_last_read = RawClock::now();
+        m_framer.commit(bytes_read);
+
+        bool valid = true;
+        while (valid) {
+          auto line = m_framer.next_line();
+          if (!line)
+            break;
+          valid = handle_line(line.value());
+        }
+        if (!valid || m_framer.full()) {
+          fail_all(VirtualGames::EndingState::unable_read_output);
+          break;
+        }
+      }
+    }
+    expire_games(RawClock::now());
+  }
+
+  m_out.append(m_responses.quit());
+  flush();
+
+  for (auto &slot : m_slots)
+    m_merged.merge(slot.game);
+  m_completed.store(true);
+}
+
+bool MultiplexRunner::initalize_app() {
+  auto app = ProcessPool::start_process(
+      m_merged.program_name(), m_merged.aiid(),
+      {"--games", std::to_string(m_slots.size())});
+  if (!app)
+    return false;
+  m_app = std::move(app.value());
+  m_watch = ProcessWatch{m_app.pid().first};
+  if (m_cpus)
+    cputopology::pin_process(m_app.pid().first, m_cpus->ai_cpu);
+  return true;
+}
+
+// "{slot} {guess}" or "{slot} -". False when the line is not tagged with a
+// known slot, the AI does not follow the protocol.
+bool MultiplexRunner::handle_line(std::string_view line) {
+  std::size_t index{0};
+  auto [ptr, ec] = std::from_chars(line.data(), line.data() + line.size(), index);
+  if (ec != std::errc{} || index >= m_slots.size() ||
+      ptr == line.data() + line.size() || *ptr != ' ') {
+    // An AI without --games answers the first E with a bare guess
+    m_untagged = !m_tagged;
+    return false;
+  }
+  m_tagged = true;
+  line.remove_prefix(static_cast<std::size_t>(ptr - line.data()) + 1);
+
+  auto &slot = m_slots[index];
+  if (slot.stale > 0) {
+    --slot.stale;
+    return true;
+  }
+  if (!slot.active)
+    return true;
+  if (slot.owed > 0)
+    --slot.owed;
+
+  if (!line.empty() && line.front() == '-') {
+    end_game(index, VirtualGames::EndingState::program_has_no_guesses);
+    return true;
+  }
+
+  bool const in_time = slot.clock.answered(m_last_read);
+  record_budget(index);
+  if (!in_time) {
+    end_game(index, VirtualGames::EndingState::timeout);
+    return true;
+  }
+
+  auto result = slot.game.guess(battleship::RowCol::from_string(line));
+  switch (result.report) {
+  case VirtualGames::GuessReport::Hit:
+    respond(index, m_responses.hit());
+    break;
+  case VirtualGames::GuessReport::Sink:
+    respond(index, m_responses.sunk(result.ship));
+    break;
+  case VirtualGames::GuessReport::Miss:
+    respond(index, m_responses.miss());
+    break;
+  }
+  slot.game.start_guess_timer();
+  slot.clock.start_move();
+
+  if (++slot.guess_count > slot.game.max_guesses())
+    end_game(index, VirtualGames::EndingState::too_many_guess);
+  else if (slot.game.sunk_all_ships())
+    end_game(index, VirtualGames::EndingState::sunk_all_ships);
+  return true;
+}
+
+void MultiplexRunner::begin_game(std::size_t slot) {
+  auto &current = m_slots[slot];
+  current.active = true;
+  current.guess_count = 0;
+  current.game.new_game();
+  respond(slot, m_responses.new_game());
+  current.game.start_guess_timer();
+  current.clock.start_game();
+  record_budget(slot);
+}
+
+void MultiplexRunner::record_budget(std::size_t slot) {
+  auto &current = m_slots[slot];
+  if (current.clock.has_budget())
+    current.game.record_budget_left(
+        std::chrono::duration_cast<VirtualGames::TimeT>(
+            current.clock.budget_left()));
+}
+
+void MultiplexRunner::end_game(std::size_t slot,
+                               VirtualGames::EndingState state) {
+  auto &current = m_slots[slot];
+  current.game.end_game(state);
+  ++current.played;
+  ++m_round;
+
+  // Whatever the AI still owes for this game belongs to no game
+  current.stale += current.owed;
+  current.owed = 0;
+
+  if (current.played < current.iterations)
+    begin_game(slot);
+  else
+    current.active = false;
+}
+
+void MultiplexRunner::expire_games(RawClock::time_point now) {
+  for (std::size_t slot = 0; slot < m_slots.size(); ++slot) {
+    if (m_slots[slot].active && now >= m_slots[slot].clock.deadline()) {
+      m_slots[slot].clock.answered(now);
+      record_budget(slot);
+      end_game(slot, VirtualGames::EndingState::timeout);
+    }
+  }
+}
+
+// The process is of no use anymore, every game left ends the same way
+void MultiplexRunner::fail_all(VirtualGames::EndingState state) {
+  for (auto &slot : m_slots) {
+    if (!slot.active)
+      continue;
+    slot.game.end_game(state);
+    ++m_round;
+    for (++slot.played; slot.played < slot.iterations; ++slot.played) {
+      slot.game.new_game();
+      slot.game.end_game(state);
+      ++m_round;
+    }
+    slot.active = false;
+  }
+  m_out.clear();
+}
+
+bool MultiplexRunner::any_active() const {
+  return std::ranges::any_of(m_slots, &Slot::active);
+}
+
+RawClock::time_point MultiplexRunner::next_deadline() const {
+  auto next = RawClock::time_point::max();
+  for (auto const &slot : m_slots) {
+    if (slot.active)
+      next = std::min(next, slot.clock.deadline());
+  }
+  return next;
+}
+
+void MultiplexRunner::respond(std::size_t slot, std::string_view text) {
+  if (m_out.view().size() + m_tags[slot].size() + text.size() >
+      OutputBuffer::capacity)
+    flush();
+  m_out.append(m_tags[slot]);
+  m_out.append(text);
+  ++m_slots[slot].owed;
+}
+
+// Every reply of the read that was just handled goes out in one write
+void MultiplexRunner::flush() {
+  if (m_out.empty())
+    return;
+  m_app.write((unsigned char *)m_out.view().data(), m_out.view().size());
+  m_out.clear();
+}
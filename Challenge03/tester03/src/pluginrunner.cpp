@@ -0,0 +1,158 @@
+#include "pluginrunner.hpp"
+#include "referenceai.hpp"
+
+#include <type_traits>
+
+#include <dlfcn.h>
+
+std::unique_ptr<AiPlugin> AiPlugin::load(std::string const &path) {
+  void *library = ::dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (!library)
+    return nullptr;
+
+  std::unique_ptr<AiPlugin> plugin{new AiPlugin()};
+  plugin->m_library = library;
+
+  auto resolve = [library](auto &function, const char *name) {
+    function = reinterpret_cast<std::remove_reference_t<decltype(function)>>(
+        ::dlsym(library, name));
+    return function != nullptr;
+  };
+
+  decltype(&::ai_abi_version) version{nullptr};
+  if (!resolve(version, "ai_abi_version") ||
+      version() != AI_PLUGIN_ABI_VERSION)
+    return nullptr;
+
+  if (!resolve(plugin->count, "ai_count") ||
+      !resolve(plugin->create, "ai_new") ||
+      !resolve(plugin->guess, "ai_guess") ||
+      !resolve(plugin->feedback, "ai_feedback") ||
+      !resolve(plugin->new_game, "ai_new_game") ||
+      !resolve(plugin->destroy, "ai_delete"))
+    return nullptr;
+
+  return plugin;
+}
+
+std::unique_ptr<AiPlugin> AiPlugin::reference() {
+  std::unique_ptr<AiPlugin> plugin{new AiPlugin()};
+  plugin->count = &reference::count;
+  plugin->create = &reference::create;
+  plugin->guess = &reference::guess;
+  plugin->feedback = &reference::feedback;
+  plugin->new_game = &reference::new_game;
+  plugin->destroy = &reference::destroy;
+  return plugin;
+}
+
+AiPlugin::~AiPlugin() {
+  if (m_library)
+    ::dlclose(m_library);
+}
+
+PluginRunner::PluginRunner(ProgramOptions::Options const &options, AIID aiid,
+                           AiPlugin const &plugin)
+    : m_plugin(&plugin), m_clock(TimeControl::from_options(options)) {
+  m_game = VirtualGames(
+      options.program_to_test, aiid,
+      {battleship::ShipDefinition{options.smallestShip},
+       battleship::ShipDefinition{options.largestShip},
+       battleship::Row{static_cast<battleship::Row::type>(options.rowSize)},
+       battleship::Col{static_cast<battleship::Col::type>(options.colSize)}},
+      options.stats_only, options.warmup_games);
+}
+
+PluginRunner::PluginRunner(PluginRunner &&other) noexcept
+    : m_game(std::move(other.m_game)), m_plugin(other.m_plugin),
+      m_ai(other.m_ai), m_clock(other.m_clock) {
+  other.m_ai = nullptr;
+  m_round.exchange(other.m_round);
+  m_completed.exchange(other.m_completed);
+}
+
+PluginRunner::~PluginRunner() {
+  if (m_ai)
+    m_plugin->destroy(m_ai);
+}
+
+void PluginRunner::start_tests(std::size_t nbrIterations) {
+  auto const layout = m_game.layout();
+  ai_layout const c_layout{
+      static_cast<uint32_t>(layout.nbrRows.size),
+      static_cast<uint32_t>(layout.nbrCols.size),
+      static_cast<uint32_t>(layout.minShipSize.size),
+      static_cast<uint32_t>(layout.maxShipSize.size)};
+
+  m_ai = m_plugin->create(m_game.aiid(), &c_layout);
+  if (!m_ai) {
+    m_completed.store(true);
+    return;
+  }
+
+  m_round.store(0);
+  m_completed.store(false);
+  for (std::size_t test_nbr = 0; test_nbr < nbrIterations; ++test_nbr) {
+    m_round.store(test_nbr);
+    m_game.new_game();
+    m_plugin->new_game(m_ai);
+    m_clock.start_game();
+    if (m_clock.has_budget())
+      m_game.record_budget_left(std::chrono::duration_cast<VirtualGames::TimeT>(
+          m_clock.budget_left()));
+    run_test();
+  }
+  m_completed.store(true);
+}
+
+void PluginRunner::run_test() {
+  std::size_t count{0};
+  const std::size_t MAX_COUNT = m_game.max_guesses();
+  m_game.start_guess_timer();
+  while (1) {
+    uint32_t row{0};
+    uint32_t col{0};
+    m_clock.start_move();
+    if (!m_plugin->guess(m_ai, &row, &col)) {
+      m_game.end_game(VirtualGames::EndingState::program_has_no_guesses);
+      return;
+    }
+    bool const too_slow = !m_clock.answered(RawClock::now());
+    if (m_clock.has_budget())
+      m_game.record_budget_left(std::chrono::duration_cast<VirtualGames::TimeT>(
+          m_clock.budget_left()));
+
+    // A guess past the time limit is not played, the game ends there
+    if (too_slow) {
+      m_game.end_game(VirtualGames::EndingState::timeout);
+      return;
+    }
+    auto result = m_game.guess(battleship::RowCol{
+        battleship::Row{static_cast<battleship::Row::type>(row)},
+        battleship::Col{static_cast<battleship::Col::type>(col)}});
+
+    switch (result.report) {
+    case VirtualGames::GuessReport::Hit:
+      m_plugin->feedback(m_ai, AI_HIT,
+                         static_cast<uint32_t>(result.ship.size));
+      break;
+    case VirtualGames::GuessReport::Sink:
+      m_plugin->feedback(m_ai, AI_SINK,
+                         static_cast<uint32_t>(result.ship.size));
+      break;
+    case VirtualGames::GuessReport::Miss:
+      m_plugin->feedback(m_ai, AI_MISS, 0);
+      break;
+    }
+    m_game.start_guess_timer();
+
+    if (++count > MAX_COUNT) {
+      m_game.end_game(VirtualGames::EndingState::too_many_guess);
+      return;
+    }
+    if (m_game.sunk_all_ships()) {
+      m_game.end_game(VirtualGames::EndingState::sunk_all_ships);
+      return;
+    }
+  }
+}
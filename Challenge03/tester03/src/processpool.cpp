@@ -0,0 +1,89 @@
+#include "processpool.hpp"
+#include "reprochelper.hpp"
+#include <system_error>
+
+ProcessPool::ProcessPool(std::string program, std::size_t spares,
+                         std::vector<std::string> extra_args)
+    : m_program(std::move(program)), m_spares(spares),
+      m_args(std::move(extra_args)),
+      m_refill([this](std::stop_token stop) { refill_loop(stop); }) {}
+
+ProcessPool::~ProcessPool() {
+  m_refill.request_stop();
+  if (m_refill.joinable())
+    m_refill.join();
+
+  // Spares never played, ask them to quit before reproc stops them
+  for (auto &[id, processes] : m_ready) {
+    for (auto &process : processes)
+      process.write((unsigned char *)"Q\n", 2);
+  }
+}
+
+std::optional<reproc::process>
+ProcessPool::start_process(std::string const &program, AIID id,
+                           std::vector<std::string> const &extra_args) {
+  reproc::process app;
+  reproc::options options{default_process_options()};
+  std::vector<std::string> cmdline{program, "run", "--ai", std::to_string(id)};
+  cmdline.insert(cmdline.end(), extra_args.begin(), extra_args.end());
+
+  if (auto ec = app.start(cmdline, options); ec)
+    return {};
+  return app;
+}
+
+void ProcessPool::prewarm(
+    std::vector<std::pair<AIID, std::size_t>> const &counts) {
+  std::vector<std::jthread> starters;
+  for (auto const &[id, count] : counts) {
+    for (std::size_t index = 0; index < count + m_spares; ++index) {
+      starters.emplace_back([this, id] {
+        auto process = start_process(m_program, id, m_args);
+        if (!process)
+          return;
+        std::scoped_lock lock{m_mutex};
+        m_ready[id].push_back(std::move(process.value()));
+      });
+    }
+  }
+}
+
+std::optional<reproc::process> ProcessPool::acquire(AIID id) {
+  {
+    std::scoped_lock lock{m_mutex};
+    auto &ready = m_ready[id];
+    if (!ready.empty()) {
+      auto process = std::move(ready.back());
+      ready.pop_back();
+      request_spare(id);
+      return process;
+    }
+  }
+  return start_process(m_program, id, m_args);
+}
+
+// Called with the mutex held
+void ProcessPool::request_spare(AIID id) {
+  if (m_ready[id].size() + m_starting[id] >= m_spares)
+    return;
+  ++m_starting[id];
+  m_to_start.push_back(id);
+  m_wake.notify_one();
+}
+
+void ProcessPool::refill_loop(std::stop_token stop) {
+  std::unique_lock lock{m_mutex};
+  while (m_wake.wait(lock, stop, [this] { return !m_to_start.empty(); })) {
+    AIID id = m_to_start.front();
+    m_to_start.pop_front();
+
+    lock.unlock();
+    auto process = start_process(m_program, id, m_args);
+    lock.lock();
+
+    --m_starting[id];
+    if (process)
+      m_ready[id].push_back(std::move(process.value()));
+  }
+}
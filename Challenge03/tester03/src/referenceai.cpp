@@ -0,0 +1,321 @@
+#include "referenceai.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <format>
+#include <random>
+#include <vector>
+
+namespace reference {
+namespace {
+
+constexpr std::array<std::string_view, 3> names{"random", "hunt/target",
+                                                "density"};
+
+enum class Cell : std::uint8_t { unknown, miss, hit, sunk };
+
+// The board as an AI knows it from the answers to its guesses
+class Player {
+public:
+  explicit Player(ai_layout const &layout)
+      : m_layout(layout),
+        m_cells(std::size_t{layout.rows} * std::size_t{layout.cols}),
+        m_random(std::random_device{}()) {}
+  virtual ~Player() = default;
+
+  virtual void new_game() {
+    std::ranges::fill(m_cells, Cell::unknown);
+    m_last = no_cell;
+    m_open_hits = 0;
+  }
+
+  bool guess(std::uint32_t &row, std::uint32_t &col) {
+    m_last = next();
+    if (m_last == no_cell)
+      return false;
+    row = static_cast<std::uint32_t>(m_last / m_layout.cols);
+    col = static_cast<std::uint32_t>(m_last % m_layout.cols);
+    return true;
+  }
+
+  void feedback(int result, std::uint32_t ship_size) {
+    if (m_last == no_cell)
+      return;
+    if (result == AI_MISS) {
+      m_cells[m_last] = Cell::miss;
+      return;
+    }
+    m_cells[m_last] = Cell::hit;
+    ++m_open_hits;
+    if (result == AI_SINK)
+      on_sink(ship_size);
+    else
+      on_hit(m_last);
+  }
+
+protected:
+  static constexpr std::size_t no_cell = SIZE_MAX;
+
+  // Next cell to guess, no_cell once every cell is guessed
+  virtual std::size_t next() = 0;
+  virtual void on_hit(std::size_t) {}
+
+  // The answers do not tell which hits the sunk ship covered. Once the sizes
+  // of the sunk ships add up to every hit, all of them are sunk.
+  virtual void on_sink(std::size_t ship_size) {
+    m_open_hits -= std::min(m_open_hits, ship_size);
+    if (m_open_hits == 0)
+      std::ranges::replace(m_cells, Cell::hit, Cell::sunk);
+  }
+
+  bool unknown(std::size_t cell) const {
+    return m_cells[cell] == Cell::unknown;
+  }
+
+  // Every cell, shuffled, with the cells of `first` ahead of the others
+  template <typename Pred> void shuffle_deck(Pred first) {
+    m_deck.resize(m_cells.size());
+    for (std::size_t cell = 0; cell < m_deck.size(); ++cell)
+      m_deck[cell] = cell;
+    auto const rest = std::ranges::stable_partition(m_deck, first);
+    std::ranges::shuffle(m_deck.begin(), rest.begin(), m_random);
+    std::ranges::shuffle(rest, m_random);
+    // Drawn from the back
+    std::ranges::reverse(m_deck);
+  }
+
+  std::size_t draw() {
+    while (!m_deck.empty()) {
+      auto const cell = m_deck.back();
+      m_deck.pop_back();
+      if (unknown(cell))
+        return cell;
+    }
+    return no_cell;
+  }
+
+  ai_layout m_layout;
+  std::vector<Cell> m_cells;
+  std::vector<std::size_t> m_deck;
+  std::mt19937_64 m_random;
+  std::size_t m_last{no_cell};
+  std::size_t m_open_hits{0}; // Hits on ships not sunk yet
+};
+
+// Guesses every cell once in a random order
+class RandomPlayer : public Player {
+public:
+  using Player::Player;
+
+  void new_game() override {
+    Player::new_game();
+    shuffle_deck([](std::size_t) { return true; });
+  }
+
+protected:
+  std::size_t next() override { return draw(); }
+};
+
+// Hunts on the cells of a checkerboard spaced by the smallest ship, which
+// every ship covers, and shoots around each hit until its ships are sunk
+class HuntTargetPlayer : public Player {
+public:
+  using Player::Player;
+
+  void new_game() override {
+    Player::new_game();
+    m_targets.clear();
+    auto const cols = m_layout.cols;
+    auto const spacing = std::max<std::size_t>(1, m_layout.smallest_ship);
+    shuffle_deck([cols, spacing](std::size_t cell) {
+      return (cell / cols + cell % cols) % spacing == 0;
+    });
+  }
+
+protected:
+  std::size_t next() override {
+    while (!m_targets.empty()) {
+      auto const cell = m_targets.back();
+      m_targets.pop_back();
+      if (unknown(cell))
+        return cell;
+    }
+    return draw();
+  }
+
+  void on_hit(std::size_t cell) override {
+    auto const row = cell / m_layout.cols;
+    auto const col = cell % m_layout.cols;
+    if (row > 0)
+      m_targets.push_back(cell - m_layout.cols);
+    if (row + 1 < m_layout.rows)
+      m_targets.push_back(cell + m_layout.cols);
+    if (col > 0)
+      m_targets.push_back(cell - 1);
+    if (col + 1 < m_layout.cols)
+      m_targets.push_back(cell + 1);
+  }
+
+  void on_sink(std::size_t ship_size) override {
+    Player::on_sink(ship_size);
+    if (m_open_hits == 0)
+      m_targets.clear();
+  }
+
+private:
+  std::vector<std::size_t> m_targets;
+};
+
+// Counts, for every cell, the placements of the ships still afloat that fit
+// the answers so far and guesses the cell most of them cover. While a ship is
+// hit and not sunk, only placements through the hits count, weighted by the
+// number of hits they explain.
+class DensityPlayer : public Player {
+public:
+  using Player::Player;
+
+  void new_game() override {
+    Player::new_game();
+    m_afloat.clear();
+    for (auto size = m_layout.smallest_ship; size <= m_layout.largest_ship;
+         ++size)
+      m_afloat.push_back(size);
+  }
+
+protected:
+  std::size_t next() override {
+    m_hunt.assign(m_cells.size(), 0);
+    m_target.assign(m_cells.size(), 0);
+    for (auto const size : m_afloat) {
+      add_placements(size, true);
+      add_placements(size, false);
+    }
+
+    auto best = most_covered(m_target);
+    if (best == no_cell)
+      best = most_covered(m_hunt);
+    if (best != no_cell)
+      return best;
+    // Nothing fits the answers, the board is not one we know of
+    auto const cell = std::ranges::find(m_cells, Cell::unknown);
+    return cell == m_cells.end()
+               ? no_cell
+               : static_cast<std::size_t>(cell - m_cells.begin());
+  }
+
+  void on_sink(std::size_t ship_size) override {
+    Player::on_sink(ship_size);
+    if (auto ship = std::ranges::find(m_afloat, ship_size);
+        ship != m_afloat.end())
+      m_afloat.erase(ship);
+  }
+
+private:
+  // Placements of a ship of size cells along the rows or down the columns
+  void add_placements(std::size_t size, bool across) {
+    std::size_t const step = across ? 1 : m_layout.cols;
+    std::size_t const step_lane = across ? m_layout.cols : 1;
+    std::size_t const lanes = across ? m_layout.rows : m_layout.cols;
+    std::size_t const length = across ? m_layout.cols : m_layout.rows;
+    if (size == 0 || size > length)
+      return;
+
+    for (std::size_t lane = 0; lane < lanes; ++lane) {
+      for (std::size_t start = 0; start + size <= length; ++start) {
+        auto const first = lane * step_lane + start * step;
+        std::size_t hits{0};
+        bool fits = true;
+        for (std::size_t part = 0; part < size && fits; ++part) {
+          auto const state = m_cells[first + part * step];
+          fits = state == Cell::unknown || state == Cell::hit;
+          hits += state == Cell::hit ? 1 : 0;
+        }
+        if (!fits)
+          continue;
+        for (std::size_t part = 0; part < size; ++part) {
+          auto const cell = first + part * step;
+          if (!unknown(cell))
+            continue;
+          ++m_hunt[cell];
+          m_target[cell] += hits;
+        }
+      }
+    }
+  }
+
+  std::size_t most_covered(std::vector<std::uint64_t> const &counts) const {
+    std::size_t best{no_cell};
+    std::uint64_t most{0};
+    for (std::size_t cell = 0; cell < counts.size(); ++cell) {
+      if (counts[cell] > most && unknown(cell)) {
+        most = counts[cell];
+        best = cell;
+      }
+    }
+    return best;
+  }
+
+  std::vector<std::uint32_t> m_afloat; // Sizes of the ships not sunk
+  std::vector<std::uint64_t> m_hunt;
+  std::vector<std::uint64_t> m_target;
+};
+
+Player *player(ai_handle *ai) { return reinterpret_cast<Player *>(ai); }
+
+} // namespace
+
+std::size_t count() { return names.size(); }
+
+std::string_view name(std::size_t id) {
+  return id < names.size() ? names[id] : std::string_view{};
+}
+
+std::string label(std::string_view program, std::size_t id) {
+  if (program == program_name && id < names.size())
+    return std::string{names[id]};
+  return std::format("AI {}", id);
+}
+
+ai_handle *create(std::size_t id, ai_layout const *layout) {
+  // The reference AIs keep every cell, they sit out the very large boards.
+  // The density AI counts every placement on the board for each guess, a
+  // game costs about the square of the cells, it stops at 64x64.
+  constexpr std::size_t max_cells = std::size_t{1} << 24;
+  constexpr std::size_t max_density_cells = std::size_t{1} << 12;
+  if (!layout || layout->rows == 0 || layout->cols == 0)
+    return nullptr;
+  auto const cells = std::size_t{layout->rows} * layout->cols;
+  if (cells > (id == 2 ? max_density_cells : max_cells))
+    return nullptr;
+
+  Player *ai{nullptr};
+  switch (id) {
+  case 0:
+    ai = new RandomPlayer(*layout);
+    break;
+  case 1:
+    ai = new HuntTargetPlayer(*layout);
+    break;
+  case 2:
+    ai = new DensityPlayer(*layout);
+    break;
+  default:
+    return nullptr;
+  }
+  ai->new_game();
+  return reinterpret_cast<ai_handle *>(ai);
+}
+
+int guess(ai_handle *ai, std::uint32_t *row, std::uint32_t *col) {
+  return player(ai)->guess(*row, *col) ? 1 : 0;
+}
+
+void feedback(ai_handle *ai, int result, std::uint32_t ship_size) {
+  player(ai)->feedback(result, ship_size);
+}
+
+void new_game(ai_handle *ai) { player(ai)->new_game(); }
+
+void destroy(ai_handle *ai) { delete player(ai); }
+
+} // namespace reference
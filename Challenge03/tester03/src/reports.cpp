@@ -1,8 +1,15 @@
 #include "baseconv.hpp"
 #include "virtualgames.hpp"
+#include <algorithm>
+#include <bit>
 #include <chrono>
+#include <cmath>
 #include <cstddef>
+#include <format>
 #include <ostream>
+#include <ranges>
+#include <string_view>
+#include <vector>
 namespace report {
 using std::ostream;
 
@@ -122,16 +129,23 @@ void print_single_game_stats(std::ostream &s, std::size_t id,
 
   s << color::text << "Total Guesses: " << color::value_normal
     << game.stats.total_guess_count << el;
+  s << color::text << "Turns: " << color::value_normal
+    << game.stats.turn_count << el;
   s << color::text << "Invalid Guesses: " << color::value_normal
     << game.stats.invalid_guess_count << el;
   s << color::text << "Repeat Guesses: " << color::value_normal
     << game.stats.repeat_guess_count << el;
+  s << color::text << "Early Guesses: " << color::value_normal
+    << game.stats.early_guess_count << el;
   s << color::text << "Shortest Answer: " << color::value_normal
     << game.stats.shortest_answer << el;
   s << color::text << "Longest answer: " << color::value_normal
     << game.stats.longest_answer << el;
   s << color::text << "Average Answer: " << color::value_normal
     << game.stats.avg_answer << el;
+  if (game.stats.timed_budget)
+    s << color::text << "Budget left: " << color::value_normal
+      << game.stats.budget_left << el;
 }
 
 // void output_games(std::ostream &s,
@@ -142,8 +156,19 @@ void print_single_game_stats(std::ostream &s, std::size_t id,
 //   }
 // }
 //
-void print_game_board(std::ostream &s, battleship::GameLayout const &layout,
-                      battleship::Ships const &ships) {
+void print_game_board(std::ostream &s, VirtualGames const &games,
+                      VirtualGames::Game const &game) {
+  auto const layout = games.layout();
+  if (!games.board_drawable()) {
+    s << color::text << "Board of " << layout.nbrRows.size << 'x'
+      << layout.nbrCols.size << " cells, ships:" << el;
+    for (auto const &ship : games.ships_of(game)) {
+      s << "  " << color::highlite << ship.size << color::reset << " at "
+        << ship.first_cell().as_base26_fmt()
+        << (ship.across ? " across" : " down") << el;
+    }
+    return;
+  }
   // Write header
   //    A B C D E F G H I J K L
   //    _______________
@@ -172,13 +197,8 @@ void print_game_board(std::ostream &s, battleship::GameLayout const &layout,
       s << " ";
     s << row << "│";
     for (std::size_t col = 0; col < layout.nbrCols.size; ++col) {
-      if (auto ship = battleship::ship_at_position(
-              ships,
-              battleship::RowCol{
-                  battleship::Row{static_cast<unsigned short>(row)},
-                  battleship::Col{static_cast<unsigned short>(col)}});
-          ship) {
-        s << color::highlite << ship.value().id().size;
+      if (auto size = games.ship_size_at(game, row, col); size != 0) {
+        s << color::highlite << size;
       } else {
         s << color::color(80, 80, 80) << ".";
       }
@@ -192,7 +212,8 @@ void print_colors_on() { color::use_color(); }
 void print_colors_off() { color::no_color(); }
 
 // Only prints the first game for now
-void print_all_moves(std::ostream &s, const VirtualGames::Game &game) {
+void print_all_moves(std::ostream &s, const VirtualGames &games,
+                     const VirtualGames::Game &game) {
   auto int_size = [](std::size_t i) -> size_t {
     if (i < 10)
       return 1;
@@ -209,17 +230,23 @@ void print_all_moves(std::ostream &s, const VirtualGames::Game &game) {
     << "0 = Unkown, 1 = Miss, 2 = Hit, 3 = Invalid, 4 = Sunk, 5 = Repeat"
     << '\n';
 
+  auto const guesses = games.guesses_of(game);
+  if (guesses.empty() && game.stats.total_guess_count > 0) {
+    s << "Moves not kept, the run used --stats-only" << '\n';
+    return;
+  }
+
   std::size_t id = 0;
   std::size_t col = 0;
   std::size_t maxcolsize = 2;
-  if (game.guesses.size() > 99) {
+  if (guesses.size() > 99) {
     maxcolsize = 3;
-  } else if (game.guesses.size() > 999) {
+  } else if (guesses.size() > 999) {
     maxcolsize = 4;
   }
   // maxcolsize = 7;
 
-  for (auto &move : game.guesses) {
+  for (auto const move : guesses) {
     s << ++id;
     s << repeat(maxcolsize - int_size(id), " ");
     s << " ";
@@ -254,6 +281,89 @@ void print_all_moves(std::ostream &s, const VirtualGames::Game &game) {
   }
 }
 
+void print_percentiles(std::ostream &s, const VirtualGames &games) {
+  auto const all = games.global_stats().all_latency();
+  if (all.count() == 0)
+    return;
+
+  auto line = [&s](std::string_view name, LatencyHistogram const &histogram) {
+    s << color::text << "  " << name << ": " << color::value_normal
+      << print_time(histogram.percentile(0.5)) << " / "
+      << print_time(histogram.percentile(0.9)) << " / "
+      << print_time(histogram.percentile(0.99)) << " / "
+      << print_time(histogram.percentile(0.999)) << color::text << " ("
+      << histogram.count() << " answers)" << el;
+  };
+
+  s << color::text << "Answer time p50 / p90 / p99 / p99.9:" << el;
+  line("All", all);
+  if (auto const &harness = games.global_stats().harness;
+      harness.count() > 0) {
+    // Shifts the percentiles by the mean, the harness spread is not removed
+    auto const cost = VirtualGames::TimeT{std::llround(harness.mean())};
+    auto const without = [&](double q) {
+      return print_time(std::max(VirtualGames::TimeT{0},
+                                 all.percentile(q) - cost));
+    };
+    s << color::text << "  All without harness: " << color::value_normal
+      << without(0.5) << " / " << without(0.9) << " / " << without(0.99)
+      << " / " << without(0.999) << el;
+  }
+  for (std::size_t phase = 0; phase < VirtualGames::Phase_Count; ++phase) {
+    auto const &histogram = games.global_stats().latency[phase];
+    if (histogram.count() > 0)
+      line(VirtualGames::Phase_ToString(static_cast<VirtualGames::Phase>(phase)),
+           histogram);
+  }
+}
+
+// One row per power of two, the sub buckets are added up
+void print_histogram(std::ostream &s, const VirtualGames &games) {
+  auto const all = games.global_stats().all_latency();
+  if (all.count() == 0)
+    return;
+
+  struct Row {
+    std::uint64_t from;
+    std::uint64_t to;
+    std::uint64_t count;
+  };
+  std::vector<Row> rows;
+  for (std::size_t bucket = 0; bucket < LatencyHistogram::bucket_count;
+       ++bucket) {
+    auto const from = LatencyHistogram::lower_bound(bucket);
+    auto const row_start = from == 0 ? 0 : std::bit_floor(from);
+    if (rows.empty() || rows.back().from != row_start)
+      rows.push_back({row_start, 0, 0});
+    rows.back().to = LatencyHistogram::upper_bound(bucket);
+    rows.back().count += all.count(bucket);
+  }
+
+  auto const first = std::ranges::find_if(
+      rows, [](Row const &row) { return row.count != 0; });
+  auto const last = std::ranges::find_if(rows.rbegin(), rows.rend(),
+                                         [](Row const &row) {
+                                           return row.count != 0;
+                                         })
+                        .base();
+  auto const highest =
+      std::ranges::max(std::ranges::subrange(first, last), {}, &Row::count)
+          .count;
+
+  constexpr std::size_t width = 50;
+  s << color::text << "Answer time histogram:" << el;
+  for (auto row = first; row != last; ++row) {
+    auto const bar = static_cast<std::size_t>(row->count * width / highest);
+    s << color::text
+      << std::format("  {:>8} - {:<8} ",
+                     std::format("{}us", row->from),
+                     std::format("{}us", row->to))
+      << color::highlite << repeat(bar, "#") << repeat(width - bar, " ")
+      << color::value_normal << ' ' << row->count << el;
+  }
+  s << color::reset;
+}
+
 void print_global_stats(std::ostream &s, const VirtualGames &games) {
 
   s << color::text << "Total time: " << color::value_normal
@@ -262,8 +372,31 @@ void print_global_stats(std::ostream &s, const VirtualGames &games) {
     << games.global_stats().invalid_guess_count << el;
   s << color::text << "Repeat Guesses: " << color::value_normal
     << games.global_stats().repeat_guess_count << el;
+  s << color::text << "Early Guesses: " << color::value_normal
+    << games.global_stats().early_guess_count << el;
+#ifdef TESTER03_COUNT_ALLOCATIONS
+  s << color::text << "Allocations while answering: " << color::value_normal
+    << games.global_stats().move_allocations << el;
+#endif
   s << color::text << "Average guess per game: " << color::value_normal
     << games.global_stats().average_guess_count << el;
+  if (auto const &spread = games.global_stats().guesses_per_game;
+      spread.count() > 1) {
+    // Two AIs whose intervals overlap are not told apart by this run
+    s << color::text << "Guesses per game: " << color::value_normal
+      << std::format("{:.2f} ± {:.2f} (95% CI), stddev {:.2f}", spread.mean(),
+                     spread.ci95(), spread.stddev())
+      << el;
+  }
+  if (games.global_stats().turn_count > 0 &&
+      games.global_stats().turn_count !=
+          games.global_stats().total_guess_count) {
+    // Salvo mode, the guesses above are still counted one shot at a time
+    s << color::text << "Average guesses per turn: " << color::value_normal
+      << static_cast<double>(games.global_stats().total_guess_count) /
+             static_cast<double>(games.global_stats().turn_count)
+      << el;
+  }
 
   s << el;
   s << color::text << "Shortest Answer: " << color::value_normal
@@ -272,6 +405,57 @@ void print_global_stats(std::ostream &s, const VirtualGames &games) {
     << print_time(games.global_stats().longest_answer) << el;
   s << color::text << "Average time to answer: " << color::value_normal
     << print_time(games.global_stats().avg_answer) << el;
+  if (auto const &spread = games.global_stats().answer_times;
+      spread.count() > 1) {
+    auto const as_time = [](double micros) {
+      return print_time(VirtualGames::TimeT{std::llround(micros)});
+    };
+    s << color::text << "Answer time stddev: " << color::value_normal
+      << as_time(spread.stddev()) << el;
+    s << color::text << "Average time to answer 95% CI: " << color::value_normal
+      << "± " << as_time(spread.ci95()) << el;
+  }
+  if (auto const &harness = games.global_stats().harness;
+      harness.count() > 0) {
+    auto const cost = VirtualGames::TimeT{std::llround(harness.mean())};
+    s << color::text << "Harness round trip (echo_ai): " << color::value_normal
+      << print_time(cost) << " ± "
+      << print_time(VirtualGames::TimeT{std::llround(harness.ci95())}) << el;
+    s << color::text << "Average time to answer without harness: "
+      << color::value_normal
+      << print_time(std::max(VirtualGames::TimeT{0},
+                             games.global_stats().avg_answer - cost))
+      << el;
+  }
+  print_percentiles(s, games);
+  if (games.global_stats().total_time.count() > 0) {
+    // Compare runs with and without --shm to see the transport cost
+    s << color::text << "Moves per second: " << color::value_normal
+      << games.global_stats().total_guess_count * 1'000'000 /
+             static_cast<std::size_t>(games.global_stats().total_time.count())
+      << el;
+  }
+  if (games.global_stats().restart_count > 0) {
+    s << color::text << "Process restarts: " << color::value_abnormal
+      << games.global_stats().restart_count << el;
+    s << color::text << "Average restart time: " << color::value_normal
+      << print_time(games.global_stats().restart_time /
+                    static_cast<VirtualGames::TimeT::rep>(
+                        games.global_stats().restart_count))
+      << el;
+    s << color::text << "Longest restart time: " << color::value_normal
+      << print_time(games.global_stats().longest_restart) << el;
+  }
+  if (games.global_stats().budget_games > 0) {
+    // Ranks AIs on speed under pressure, not only on time outs
+    s << color::text << "Average budget left: " << color::value_normal
+      << print_time(games.global_stats().budget_left /
+                    static_cast<VirtualGames::TimeT::rep>(
+                        games.global_stats().budget_games))
+      << el;
+    s << color::text << "Lowest budget left: " << color::value_normal
+      << print_time(games.global_stats().lowest_budget_left) << el;
+  }
 
   s << color::text << "Count of games 'timed out': " << color::value_normal
     << games.global_stats().ending_state(VirtualGames::EndingState::timeout)
@@ -297,8 +481,16 @@ void print_global_stats(std::ostream &s, const VirtualGames &games) {
     << games.global_stats().ending_state(
            VirtualGames::EndingState::program_has_no_guesses)
     << el;
+  s << color::text << "Count of games 'crashed': " << color::value_normal
+    << games.global_stats().ending_state(VirtualGames::EndingState::crashed)
+    << el;
   s << color::text << "Count of games 'unknown': " << color::value_abnormal
     << games.global_stats().ending_state(VirtualGames::EndingState::none) << el;
+  s << color::text
+    << "Count of games 'ships_not_placed': " << color::value_abnormal
+    << games.global_stats().ending_state(
+           VirtualGames::EndingState::ships_not_placed)
+    << el;
 
   s << color::text << "Count of games 'sunk_all_ships': " << color::value_normal
     << games.global_stats().ending_state(
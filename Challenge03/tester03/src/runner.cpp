@@ -1,17 +1,31 @@
 #include "runner.hpp"
+#include "aicache.hpp"
 #include "aistats.hpp"
+#include "cputopology.hpp"
+#include "eventloop.hpp"
+#include "journal.hpp"
+#include "multiplexrunner.hpp"
+#include "pluginrunner.hpp"
+#include "processpool.hpp"
 #include "programoptions.hpp"
+#include "referenceai.hpp"
 #include "reports.hpp"
 #include "reproc++/reproc.hpp"
 #include "reprochelper.hpp"
 #include "showreport.hpp"
 #include "testrunner.hpp"
 #include "virtualgames.hpp"
+#include <algorithm>
 #include <charconv>
 #include <chrono>
 #include <cstddef>
+#include <filesystem>
+#include <format>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <map>
 #include <numeric>
 #include <optional>
 #include <ostream>
@@ -20,6 +34,7 @@
 #include <vector>
 
 const size_t MAX_ITERATIONS_PER_THREAD = 1500;
+const size_t WARM_SPARES_PER_AI = 1;
 
 void write_file_csv(ProgramOptions::Options opt,
                     std::vector<VirtualGames> &&games);
@@ -27,8 +42,14 @@ void write_file_csv(ProgramOptions::Options opt,
 void write_file_report(ProgramOptions::Options opt,
                        std::vector<VirtualGames> &&games);
 
+bool output_results(ProgramOptions::Options const &opt,
+                    std::vector<VirtualGames> &&games);
+
 std::optional<std::size_t>
 get_ai_number_from_app(ProgramOptions::Options const &opt) {
+  if (auto cached = aicache::lookup(opt.program_to_test); cached)
+    return cached;
+
   reproc::process app;
   reproc::options options{default_process_options()};
 
@@ -38,18 +59,36 @@ get_ai_number_from_app(ProgramOptions::Options const &opt) {
   if (ec == std::errc::no_such_file_or_directory)
     return {};
 
+  // The number may arrive in several reads, stop at the end of its line or
+  // after a second, a program that never answers must not hang the tester
+  auto const deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(1000);
+  std::string output;
   unsigned char buff[255];
-  std::size_t bytes_read;
-  std::tie(bytes_read, ec) =
-      app.read(reproc::stream::out, (unsigned char *)&buff, 254);
+  while (output.find('\n') == std::string::npos) {
+    auto const remaining = std::chrono::duration_cast<reproc::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    if (remaining <= reproc::milliseconds(0))
+      break;
+    auto const event = app.poll(reproc::event::out, remaining);
+    if (event.second || event.first != reproc::event::out)
+      break;
+    std::size_t bytes_read{0};
+    std::tie(bytes_read, ec) =
+        app.read(reproc::stream::out, (unsigned char *)&buff, 254);
+    if (ec || bytes_read == 0)
+      break;
+    output.append((char *)buff, bytes_read);
+  }
 
   options.stop.first = {reproc::stop::wait, reproc::milliseconds(1000)};
   app.stop(options.stop);
-  if (bytes_read != 0) {
+  if (!output.empty()) {
     std::size_t nbrAi{0};
-    auto result =
-        std::from_chars((char *)buff, (char *)(buff + bytes_read), nbrAi);
-    if (result.ptr != (char *)buff) {
+    auto result = std::from_chars(output.data(),
+                                  output.data() + output.size(), nbrAi);
+    if (result.ptr != output.data()) {
+      aicache::store(opt.program_to_test, nbrAi);
       return nbrAi;
     }
   }
@@ -63,7 +102,13 @@ get_requested_ai(ProgramOptions::Options const &opt) {
 
   // Get all the AIs that the user wants to test
   if (opt.all_ai) {
-    auto ai_count = get_ai_number_from_app(opt);
+    std::optional<std::size_t> ai_count;
+    if (opt.plugin) {
+      if (auto plugin = AiPlugin::load(opt.program_to_test); plugin)
+        ai_count = plugin->count();
+    } else {
+      ai_count = get_ai_number_from_app(opt);
+    }
     if (ai_count) {
       // std::cout << "Total number of AIs found: " << ai_count.value() <<
       // '\n';
@@ -102,65 +147,102 @@ private:
   const unsigned char r, g, b;
 };
 
-struct ScheduledTest {
-  TestRunner runner;
+struct ScheduledShard {
+  AIID aiid;
   std::size_t iterations;
+  std::size_t group; // Index of the AI in the requested AI list
 };
 
-// std::vector<ScheduledTest> make_test_tasks(ProgramOptions::Options const &
-// opt,  std::vector<AIID> const &ids) {
-//
-//   std::vector<TestRunner> schedule;
-//   std::size_t extra_tasks = 1;
-//   if (opt.nbrIterations > MAX_ITERATIONS_PER_THREAD) {
-//     auto tasks_division = std::div(iterations, MAX_ITERATIONS_PER_THREAD);
-//     for (std::size_t count = 0; count < tasks_division; ++count) {
-//          schedule.emplace_back(TestRunner{opt, id)
-//
-
-bool test(ProgramOptions::Options const &opt) {
-
-  std::string_view const bar = "▒";
-  auto ai_ids_opt = get_requested_ai(opt);
-
-  if (!ai_ids_opt)
-    return false;
-
-  auto &ai_ids = ai_ids_opt.value();
-
-  std::vector<TestRunner> tests;
+struct ShardProgress {
+  std::size_t round;
+  bool completed;
+};
 
-  for (auto ai_id : ai_ids) {
-    tests.emplace_back(opt, ai_id);
-  };
+// Splits the iterations of every AI across several shards (each with its own
+// process). Shards are added until each one has at most
+// MAX_ITERATIONS_PER_THREAD iterations or the instance budget is used up.
+// Every AI gets at least one shard.
+std::vector<ScheduledShard> make_schedule(ProgramOptions::Options const &opt,
+                                          std::vector<AIID> const &ids) {
+  std::size_t budget = opt.max_threads;
+  if (budget == 0)
+    budget = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+  budget = std::max(budget, ids.size());
+
+  const std::size_t wanted_shards = std::max<std::size_t>(
+      1, (opt.nbrIterations + MAX_ITERATIONS_PER_THREAD - 1) /
+             MAX_ITERATIONS_PER_THREAD);
+
+  std::vector<std::size_t> shards(ids.size());
+  for (std::size_t group = 0; group < ids.size(); ++group) {
+    std::size_t share =
+        budget / ids.size() + (group < budget % ids.size() ? 1 : 0);
+    shards[group] = std::min(wanted_shards, share);
+  }
 
-  std::atomic<bool> done_thread{false};
+  std::vector<ScheduledShard> schedule;
+  schedule.reserve(std::accumulate(shards.begin(), shards.end(), 0uz));
 
-  auto thread_me = [](std::vector<TestRunner>::iterator it,
-                      std::size_t iterations) { it->start_tests(iterations); };
+  for (std::size_t group = 0; group < ids.size(); ++group) {
+    const std::size_t per_shard = opt.nbrIterations / shards[group];
+    const std::size_t remainder = opt.nbrIterations % shards[group];
+    for (std::size_t shard = 0; shard < shards[group]; ++shard) {
+      std::size_t iterations = per_shard + (shard < remainder ? 1 : 0);
+      schedule.push_back(ScheduledShard{ids[group], iterations, group});
+    }
+  }
+  return schedule;
+}
 
-  std::vector<std::jthread> threads;
+// Draws one progress bar per AI until every shard is completed
+void show_progress(
+    ProgramOptions::Options const &opt, std::vector<AIID> const &ai_ids,
+    std::vector<ScheduledShard> const &schedule,
+    std::function<ShardProgress(std::size_t)> const &progress) {
 
-  for (auto it = tests.begin(); it != tests.end(); ++it) {
+  std::string_view const bar = "▒";
 
-    threads.emplace_back(thread_me, it, opt.nbrIterations);
+  if (!opt.show_progress) {
+    auto const done = [&] {
+      for (std::size_t shard = 0; shard < schedule.size(); ++shard) {
+        if (!progress(shard).completed)
+          return false;
+      }
+      return true;
+    };
+    while (!done())
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    return;
   }
 
   std::cout << '\n';
   // std::cout << "\e[H";
-  std::cout << tests.front().games().program_name() << '\n';
-  while (done_thread == false) {
+  std::cout << opt.program_to_test << '\n';
+  while (true) {
 
     std::size_t nbr_finished = 0;
-    // Now write the AI
-    for (auto &it : tests) {
+    // Now write the AI, summing the progress of every shard it was split into
+    for (std::size_t group = 0; group < ai_ids.size(); ++group) {
+      std::size_t current_round = 0;
+      bool completed = true;
+      for (std::size_t shard = 0; shard < schedule.size(); ++shard) {
+        if (schedule[shard].group != group)
+          continue;
+        auto const status = progress(shard);
+        if (status.completed) {
+          current_round += schedule[shard].iterations;
+        } else {
+          completed = false;
+          current_round += status.round;
+        }
+      }
+
       std::cout << "\e[0K" << "\e[0m"; // Erase to end of line
-      std::cout << it.games().aiid() << " :: ";
-      if (it.is_completed()) {
+      std::cout << ai_ids[group] << " :: ";
+      if (completed) {
         std::cout << "\e[38;2;0;220;0m" << "done";
         ++nbr_finished;
       } else {
-        auto current_round = it.current_round();
         std::cout << "\e[0m" << std::setw(5) << current_round << " :: ";
         auto percent = ((current_round * 100) / opt.nbrIterations) / 4;
         std::cout << std::setw(3) << percent * 4 << "% :: ";
@@ -175,35 +257,513 @@ bool test(ProgramOptions::Options const &opt) {
       std::cout << '\n';
     }
 
-    if (nbr_finished >= tests.size()) {
-      done_thread = true;
+    if (nbr_finished >= ai_ids.size())
       break;
-    }
 
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    std::cout << "\e[" << tests.size() << 'F';
+    std::cout << "\e[" << ai_ids.size() << 'F';
+  }
+}
+
+// Shards of the same AI are next to each other, merge them into one result
+std::vector<VirtualGames> merge_shards(
+    std::size_t nbrAi, std::vector<ScheduledShard> const &schedule,
+    std::function<const VirtualGames &(std::size_t)> const &games_of) {
+  std::vector<VirtualGames> games;
+  games.reserve(nbrAi);
+  for (std::size_t shard = 0; shard < schedule.size(); ++shard) {
+    if (shard == 0 || schedule[shard].group != schedule[shard - 1].group)
+      games.push_back(games_of(shard));
+    else
+      games.back().merge(games_of(shard));
+  }
+  return games;
+}
+
+// One TestRunner and one thread per shard. Every process is started up front
+// by the pool.
+std::vector<VirtualGames>
+run_with_threads(ProgramOptions::Options const &opt,
+                 std::vector<AIID> const &ai_ids,
+                 std::vector<ScheduledShard> const &schedule) {
+  std::vector<std::string> pool_args;
+  if (opt.line_per_reply)
+    pool_args.push_back("--line-per-reply");
+  ProcessPool pool{opt.program_to_test, WARM_SPARES_PER_AI, pool_args};
+
+  std::vector<std::pair<AIID, std::size_t>> counts;
+  for (auto const &shard : schedule) {
+    if (counts.empty() || counts.back().first != shard.aiid)
+      counts.emplace_back(shard.aiid, 0);
+    ++counts.back().second;
+  }
+  // Salvo and shm processes need their own arguments, the pool cannot start
+  // them. Spares started for them would only sit idle until the end.
+  ProcessPool *shared_pool =
+      opt.salvo_shots > 1 || opt.shm_transport ? nullptr : &pool;
+  if (shared_pool)
+    pool.prewarm(counts);
+
+  std::vector<TestRunner> runners;
+  runners.reserve(schedule.size());
+  for (auto const &shard : schedule)
+    runners.emplace_back(opt, shard.aiid, shared_pool);
+
+  if (opt.pin_cpus) {
+    auto const pairs = cputopology::sibling_pairs();
+    for (std::size_t shard = 0; shard < runners.size() && !pairs.empty();
+         ++shard)
+      runners[shard].pin_to(pairs[shard % pairs.size()]);
+  }
+
+  {
+    std::vector<std::jthread> threads;
+    for (std::size_t shard = 0; shard < schedule.size(); ++shard) {
+      threads.emplace_back(
+          [&runner = runners[shard], iterations = schedule[shard].iterations] {
+            runner.start_tests(iterations);
+          });
+    }
+
+    show_progress(opt, ai_ids, schedule, [&runners](std::size_t shard) {
+      return ShardProgress{runners[shard].current_round(),
+                           runners[shard].is_completed()};
+    });
+  }
+
+  return merge_shards(ai_ids.size(), schedule,
+                      [&runners](std::size_t shard) -> const VirtualGames & {
+                        return runners[shard].games();
+                      });
+}
+
+// One MultiplexRunner and one thread per shard, each process plays
+// opt.multiplex_games games at once
+std::vector<VirtualGames>
+run_multiplexed(ProgramOptions::Options const &opt,
+                std::vector<AIID> const &ai_ids,
+                std::vector<ScheduledShard> const &schedule) {
+  std::vector<MultiplexRunner> runners;
+  runners.reserve(schedule.size());
+  for (auto const &shard : schedule)
+    runners.emplace_back(opt, shard.aiid, opt.multiplex_games);
+
+  if (opt.pin_cpus) {
+    auto const pairs = cputopology::sibling_pairs();
+    for (std::size_t shard = 0; shard < runners.size() && !pairs.empty();
+         ++shard)
+      runners[shard].pin_to(pairs[shard % pairs.size()]);
+  }
+
+  {
+    std::vector<std::jthread> threads;
+    for (std::size_t shard = 0; shard < schedule.size(); ++shard) {
+      threads.emplace_back(
+          [&runner = runners[shard], iterations = schedule[shard].iterations] {
+            runner.start_tests(iterations);
+          });
+    }
+
+    show_progress(opt, ai_ids, schedule, [&runners](std::size_t shard) {
+      return ShardProgress{runners[shard].current_round(),
+                           runners[shard].is_completed()};
+    });
+  }
+
+  // Its games all end as unreadable, say why
+  if (std::ranges::any_of(runners, &MultiplexRunner::answered_untagged))
+    std::cout << opt.program_to_test
+              << " answered without a game number, --games only works with "
+                 "an AI that implements it\n";
+
+  return merge_shards(ai_ids.size(), schedule,
+                      [&runners](std::size_t shard) -> const VirtualGames & {
+                        return runners[shard].games();
+                      });
+}
+
+// One PluginRunner and one thread per shard, the AIs run in this process
+std::vector<VirtualGames>
+run_with_plugin(ProgramOptions::Options const &opt,
+                std::vector<AIID> const &ai_ids,
+                std::vector<ScheduledShard> const &schedule,
+                AiPlugin const &plugin) {
+  std::vector<PluginRunner> runners;
+  runners.reserve(schedule.size());
+  for (auto const &shard : schedule)
+    runners.emplace_back(opt, shard.aiid, plugin);
+
+  {
+    std::vector<std::jthread> threads;
+    for (std::size_t shard = 0; shard < schedule.size(); ++shard) {
+      threads.emplace_back(
+          [&runner = runners[shard], iterations = schedule[shard].iterations,
+           &opt, shard] {
+            if (opt.pin_cpus) {
+              auto const pairs = cputopology::sibling_pairs();
+              if (!pairs.empty())
+                cputopology::pin_current_thread(
+                    pairs[shard % pairs.size()].runner_cpu);
+            }
+            runner.start_tests(iterations);
+          });
+    }
+
+    show_progress(opt, ai_ids, schedule, [&runners](std::size_t shard) {
+      return ShardProgress{runners[shard].current_round(),
+                           runners[shard].is_completed()};
+    });
+  }
+
+  auto games = merge_shards(ai_ids.size(), schedule,
+                            [&runners](std::size_t shard)
+                                -> const VirtualGames & {
+                              return runners[shard].games();
+                            });
+  // The AI handles live in the library, free them before it is unloaded
+  runners.clear();
+  return games;
+}
+
+// Every shard driven by a few epoll event loop threads
+std::vector<VirtualGames>
+run_with_event_loop(ProgramOptions::Options const &opt,
+                    std::vector<AIID> const &ai_ids,
+                    std::vector<ScheduledShard> const &schedule) {
+  std::vector<EventLoopRunner::Shard> shards;
+  shards.reserve(schedule.size());
+  for (auto const &shard : schedule)
+    shards.push_back({shard.aiid, shard.iterations});
+
+  EventLoopRunner runner{opt, shards};
+  if (opt.pin_cpus)
+    runner.pin_to(cputopology::sibling_pairs());
+  {
+    std::jthread engine{[&runner, &opt] { runner.run(opt.event_loops); }};
+
+    show_progress(opt, ai_ids, schedule, [&runner](std::size_t shard) {
+      return ShardProgress{runner.current_round(shard),
+                           runner.is_completed(shard)};
+    });
+  }
+
+  return merge_shards(ai_ids.size(), schedule,
+                      [&runner](std::size_t shard) -> const VirtualGames & {
+                        return runner.games(shard);
+                      });
+}
+
+// Shard i of N plays its share of the iterations of every AI
+ProgramOptions::Options shard_options(ProgramOptions::Options opt) {
+  if (opt.shard_count > 1) {
+    opt.nbrIterations = opt.nbrIterations / opt.shard_count +
+                        (opt.shard_index < opt.nbrIterations % opt.shard_count
+                             ? 1
+                             : 0);
+  }
+  return opt;
+}
+
+// Plays every shard with the engine picked by the options
+std::vector<VirtualGames> play(ProgramOptions::Options const &opt,
+                               std::vector<AIID> const &ai_ids,
+                               std::vector<ScheduledShard> const &schedule) {
+  if (opt.plugin) {
+    auto plugin = AiPlugin::load(opt.program_to_test);
+    if (!plugin) {
+      std::cout << "Unable to load plugin: " << opt.program_to_test << '\n';
+      return {};
+    }
+    return run_with_plugin(opt, ai_ids, schedule, *plugin);
+  }
+  if (opt.engine == ProgramOptions::Engine::epoll)
+    return run_with_event_loop(opt, ai_ids, schedule);
+  if (opt.multiplex_games > 1 && opt.salvo_shots <= 1)
+    return run_multiplexed(opt, ai_ids, schedule);
+  return run_with_threads(opt, ai_ids, schedule);
+}
+
+// echo_ai is built next to tester03
+std::string echo_ai_path() {
+  std::error_code ec;
+  auto const self = std::filesystem::read_symlink("/proc/self/exe", ec);
+  if (ec)
+    return "echo_ai";
+  return (self.parent_path() / "echo_ai").string();
+}
+
+// `instances` copies of AI 0 of program, playing statistics only
+ProgramOptions::Options measure_options(ProgramOptions::Options opt,
+                                        std::string program,
+                                        std::size_t instances) {
+  // echo_ai answers every reply
+  opt.line_per_reply = program == echo_ai_path();
+  opt.program_to_test = std::move(program);
+  opt.plugin = false;
+  opt.all_ai = false;
+  opt.ai_id_to_test.assign(instances, 0);
+  opt.max_threads = instances;
+  opt.stats_only = true;
+  opt.warmup_games = 0;
+  opt.show_progress = false;
+  return opt;
+}
+
+std::optional<VirtualGames> merge_instances(std::vector<VirtualGames> games) {
+  if (games.empty())
+    return {};
+  for (std::size_t index = 1; index < games.size(); ++index)
+    games.front().merge(games[index]);
+  return std::move(games.front());
+}
+
+// Plays the transport of opt against echo_ai with `instances` processes.
+// echo_ai answers at once, every answer time is the cost of the tester.
+std::optional<VirtualGames> play_echo(ProgramOptions::Options const &options,
+                                      std::string const &echo,
+                                      std::size_t instances) {
+  auto const opt = measure_options(options, echo, instances);
+  auto const schedule = make_schedule(opt, opt.ai_id_to_test);
+  return merge_instances(play(opt, opt.ai_id_to_test, schedule));
+}
+
+// Same with the random reference AI played in process: the cost of the
+// tester without pipes or processes
+std::optional<VirtualGames>
+play_in_process(ProgramOptions::Options const &options,
+                std::size_t instances) {
+  auto const opt = measure_options(
+      options, std::string{reference::program_name}, instances);
+  auto const schedule = make_schedule(opt, opt.ai_id_to_test);
+  return merge_instances(run_with_plugin(opt, opt.ai_id_to_test, schedule,
+                                         *AiPlugin::reference()));
+}
+
+// Plays the AIs of referenceai.hpp with the options of the run, in process
+std::vector<VirtualGames> play_reference(ProgramOptions::Options opt) {
+  opt.program_to_test = std::string{reference::program_name};
+  opt.plugin = true;
+  opt.all_ai = false;
+  opt.ai_id_to_test.resize(reference::count());
+  std::iota(opt.ai_id_to_test.begin(), opt.ai_id_to_test.end(), 0);
+
+  auto const schedule = make_schedule(opt, opt.ai_id_to_test);
+  return run_with_plugin(opt, opt.ai_id_to_test, schedule,
+                         *AiPlugin::reference());
+}
+
+// Answer times of echo_ai with the transport and the number of instances of
+// the run, see --baseline
+std::optional<RunningStats> measure_harness(ProgramOptions::Options opt,
+                                            std::size_t instances) {
+  auto const echo = echo_ai_path();
+  if (opt.plugin || !std::filesystem::exists(echo)) {
+    std::cout << "No harness baseline, it needs " << echo
+              << " and an AI program\n";
+    return {};
+  }
+  // Enough moves for a stable mean without doubling the run
+  opt.nbrIterations = std::min<std::size_t>(opt.nbrIterations, 50);
+  auto const echo_games = play_echo(opt, echo, instances);
+  if (!echo_games)
+    return {};
+  return echo_games->global_stats().answer_times;
+}
+
+bool test(ProgramOptions::Options const &options) {
+
+  auto const opt = shard_options(options);
+  if (opt.nbrIterations == 0)
+    return false;
+
+  auto ai_ids_opt = get_requested_ai(opt);
+
+  if (!ai_ids_opt)
+    return false;
+
+  auto &ai_ids = ai_ids_opt.value();
+
+  if (ai_ids.empty())
+    return false;
+
+  auto const schedule = make_schedule(opt, ai_ids);
+
+  auto games = play(opt, ai_ids, schedule);
+  if (games.empty())
+    return false;
+
+  if (opt.reference_ais) {
+    auto reference = play_reference(opt);
+    games.insert(games.end(), std::make_move_iterator(reference.begin()),
+                 std::make_move_iterator(reference.end()));
+  }
+
+  if (opt.subtract_baseline) {
+    if (auto harness = measure_harness(opt, schedule.size()); harness) {
+      // The reference AIs run in process, there is no harness to subtract
+      for (auto &ai : games) {
+        if (ai.program_name() != reference::program_name)
+          ai.record_harness(harness.value());
+      }
+    }
+  }
+
+  return output_results(opt, std::move(games));
+}
+
+// Harness cost and highest moves per second of every transport, from one
+// instance up to --threads instances
+bool calibrate(ProgramOptions::Options const &options) {
+  auto const echo = options.program_to_test.empty() ? echo_ai_path()
+                                                    : options.program_to_test;
+  if (!std::filesystem::exists(echo)) {
+    std::cout << "Unable to find echo_ai: " << echo << '\n';
+    return false;
   }
 
-  for (auto &thread : threads) {
-    thread.join();
+  std::size_t most = options.max_threads;
+  if (most == 0)
+    most = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+  std::vector<std::size_t> levels;
+  for (std::size_t level = 1; level < most; level *= 2)
+    levels.push_back(level);
+  levels.push_back(most);
+
+  struct Transport {
+    std::string name;
+    std::function<void(ProgramOptions::Options &)> apply;
+    bool in_process{false};
+  };
+  auto const games = std::max<std::size_t>(2, options.multiplex_games);
+  std::vector<Transport> const transports{
+      {"pipes", [](auto &) {}},
+      {"shm", [](auto &opt) { opt.shm_transport = true; }},
+      {"epoll", [](auto &opt) {
+         opt.engine = ProgramOptions::Engine::epoll;
+       }},
+      {std::format("games {}", games),
+       [games](auto &opt) { opt.multiplex_games = games; }},
+      {"in process", [](auto &) {}, true}};
+
+  std::cout << std::format("{:<10} {:>9} {:>10} {:>10} {:>10} {:>10} {:>12}\n",
+                           "Transport", "Instances", "Moves", "Mean", "p50",
+                           "p99", "Moves/sec");
+  for (auto const &transport : transports) {
+    for (auto const level : levels) {
+      auto opt = options;
+      opt.engine = ProgramOptions::Engine::threads;
+      opt.shm_transport = false;
+      opt.multiplex_games = 1;
+      transport.apply(opt);
+
+      auto const start = std::chrono::steady_clock::now();
+      auto const result = transport.in_process
+                              ? play_in_process(opt, level)
+                              : play_echo(opt, echo, level);
+      auto const wall = std::chrono::duration<double>(
+          std::chrono::steady_clock::now() - start);
+      if (!result) {
+        std::cout << std::format("{:<10} {:>9} failed\n", transport.name,
+                                 level);
+        continue;
+      }
+
+      auto const &stats = result->global_stats();
+      auto const all = stats.all_latency();
+      std::cout << std::format(
+          "{:<10} {:>9} {:>10} {:>8.1f}us {:>8}us {:>8}us {:>12.0f}\n",
+          transport.name, level, stats.total_guess_count,
+          stats.answer_times.mean(), all.percentile(0.5).count(),
+          all.percentile(0.99).count(),
+          static_cast<double>(stats.total_guess_count) / wall.count());
+    }
   }
+  return true;
+}
 
+bool merge(ProgramOptions::Options const &options) {
+  auto opt = options;
   std::vector<VirtualGames> games;
-  for (auto const &runner : tests) {
-    games.push_back(std::move(runner.games()));
+  // Program and AI id to its entry in games, the reference AIs share ids
+  // with the AIs of the program
+  std::map<std::pair<std::string, AIID>, std::size_t> index_of;
+  std::vector<bool> seen_shards;
+
+  for (auto const &path : opt.journal_files) {
+    auto shard = journal::read(path);
+    if (!shard)
+      return false;
+
+    if (seen_shards.empty())
+      seen_shards.resize(shard->count);
+    if (shard->count != seen_shards.size() ||
+        shard->index >= seen_shards.size()) {
+      std::cout << "Journal " << path << " is from a different run\n";
+      return false;
+    }
+    if (seen_shards[shard->index]) {
+      std::cout << "Journal " << path << " repeats shard " << shard->index
+                << '\n';
+      return false;
+    }
+    seen_shards[shard->index] = true;
+
+    for (auto &ai : shard->games) {
+      if (!games.empty()) {
+        auto const a = games.front().layout();
+        auto const b = ai.layout();
+        if (a.nbrRows.size != b.nbrRows.size ||
+            a.nbrCols.size != b.nbrCols.size ||
+            a.minShipSize.size != b.minShipSize.size ||
+            a.maxShipSize.size != b.maxShipSize.size) {
+          std::cout << "Journal " << path << " uses a different layout\n";
+          return false;
+        }
+      }
+
+      auto [entry, added] = index_of.try_emplace(
+          std::pair{ai.program_name(), ai.aiid()}, games.size());
+      if (added)
+        games.push_back(std::move(ai));
+      else
+        games[entry->second].merge(ai);
+    }
   }
 
+  if (auto missing = std::ranges::find(seen_shards, false);
+      missing != seen_shards.end())
+    std::cout << "Warning: shard " << missing - seen_shards.begin()
+              << " is missing, the results are partial\n";
+
+  if (games.empty())
+    return false;
+
+  opt.program_to_test = games.front().program_name();
+  return output_results(opt, std::move(games));
+}
+
+// Shows the results or writes them to opt.result_file
+bool output_results(ProgramOptions::Options const &opt,
+                    std::vector<VirtualGames> &&games) {
   if (opt.result_file == "") {
     ui::start(opt, games);
-  } else {
-    std::cout << "Writing file with type: ";
-    if (opt.filemode == ProgramOptions::FileOutput::report) {
-      std::cout << "report" << '\n' << "file name: " << opt.result_file << '\n';
-      write_file_report(opt, std::move(games));
-    } else {
-      std::cout << "csv" << '\n' << "file name: " << opt.result_file << '\n';
-      write_file_csv(opt, std::move(games));
-    }
+    return true;
+  }
+
+  std::cout << "Writing file with type: ";
+  switch (opt.filemode) {
+  case ProgramOptions::FileOutput::report:
+    std::cout << "report" << '\n' << "file name: " << opt.result_file << '\n';
+    write_file_report(opt, std::move(games));
+    break;
+  case ProgramOptions::FileOutput::csv:
+    std::cout << "csv" << '\n' << "file name: " << opt.result_file << '\n';
+    write_file_csv(opt, std::move(games));
+    break;
+  case ProgramOptions::FileOutput::journal:
+    std::cout << "journal" << '\n' << "file name: " << opt.result_file << '\n';
+    return journal::write(opt.result_file, opt.shard_index, opt.shard_count,
+                          games);
   }
   return true;
 }
@@ -231,8 +791,8 @@ void write_file_csv(ProgramOptions::Options opt,
     for (std::size_t roundid = 0; roundid < game.all_games().size();
          ++roundid) {
       auto &round = game.all_games()[roundid];
-      for (std::size_t guessid = 0; guessid < round.guesses.size(); ++guessid) {
-        auto &guess = round.guesses[guessid];
+      std::size_t guessid = 0;
+      for (auto const guess : game.guesses_of(round)) {
         file << game.aiid() << ',';
         file << gameid << ',';
         file << roundid << ',';
@@ -241,6 +801,7 @@ void write_file_csv(ProgramOptions::Options opt,
         file << guess.result_as_string() << ',';
         file << guess.elapsed_time << ',';
         file << '\n';
+        ++guessid;
       }
     }
   }
@@ -264,13 +825,18 @@ void write_file_report(ProgramOptions::Options opt,
   report::print_colors_off();
   for (auto &game : games) {
     std::size_t runID = 0;
+    file << '\n'
+         << "* " << reference::label(game.program_name(), game.aiid())
+         << " of " << game.program_name() << '\n';
     report::print_global_stats(file, game);
+    if (opt.display_histogram)
+      report::print_histogram(file, game);
 
     for (auto &run : game.all_games()) {
       file << '\n';
       file << "** Run: " << runID++ << '\n';
-      report::print_game_board(file, game.layout(), run.ships);
-      report::print_all_moves(file, run);
+      report::print_game_board(file, game, run);
+      report::print_all_moves(file, game, run);
       file << '\n';
     }
   }
@@ -281,8 +847,8 @@ void write_file_report(ProgramOptions::Options opt,
 void output_report(std::ostream &s, VirtualGames const &games) {
   report::print_colors_on();
   report::print_global_stats(s, games);
-  report::print_game_board(s, games.layout(), games.all_games().front().ships);
+  report::print_game_board(s, games, games.all_games().front());
 
-  report::print_all_moves(std::cout, games.all_games()[0]);
-  report::print_all_moves(std::cout, games.all_games()[1]);
+  report::print_all_moves(std::cout, games, games.all_games()[0]);
+  report::print_all_moves(std::cout, games, games.all_games()[1]);
 }
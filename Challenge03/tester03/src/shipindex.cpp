@@ -0,0 +1,60 @@
+#include "shipindex.hpp"
+#include <random>
+
+namespace {
+// Tries per ship before the layout is started over
+constexpr std::size_t PLACEMENT_TRIES = 1000;
+constexpr std::size_t LAYOUT_TRIES = 20;
+
+std::mt19937_64 &generator() {
+  thread_local std::mt19937_64 random{std::random_device{}()};
+  return random;
+}
+
+bool place(ShipIndex &index, std::size_t size, std::size_t rows,
+           std::size_t cols) {
+  auto &random = generator();
+  for (std::size_t attempt = 0; attempt < PLACEMENT_TRIES; ++attempt) {
+    bool across = random() % 2 == 0;
+    if (size > cols)
+      across = false;
+    if (size > rows)
+      across = true;
+    auto const lanes = across ? rows : cols;
+    auto const length = across ? cols : rows;
+    if (size > length)
+      return false;
+
+    auto const lane = std::uniform_int_distribution<std::size_t>{
+        0, lanes - 1}(random);
+    auto const start = std::uniform_int_distribution<std::size_t>{
+        0, length - size}(random);
+    ShipPlacement const ship{
+        static_cast<std::uint16_t>(across ? lane : start),
+        static_cast<std::uint16_t>(across ? start : lane),
+        static_cast<std::uint16_t>(size), across};
+    if (index.fits(ship)) {
+      index.add(ship);
+      return true;
+    }
+  }
+  return false;
+}
+} // namespace
+
+bool shipindex::random_fill(ShipIndex &index,
+                            battleship::GameLayout const &layout) {
+  std::size_t const rows = layout.nbrRows.size;
+  std::size_t const cols = layout.nbrCols.size;
+  for (std::size_t layout_try = 0; layout_try < LAYOUT_TRIES; ++layout_try) {
+    index.clear();
+    // Largest first, they are the hardest to fit
+    bool placed = true;
+    for (auto size = layout.maxShipSize.size;
+         placed && size >= layout.minShipSize.size && size > 0; --size)
+      placed = place(index, size, rows, cols);
+    if (placed)
+      return true;
+  }
+  return false;
+}
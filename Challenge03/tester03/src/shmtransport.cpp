@@ -0,0 +1,80 @@
+#include "shmtransport.hpp"
+#include <atomic>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+std::unique_ptr<ShmTransport> ShmTransport::create() {
+  static std::atomic<unsigned> counter{0};
+  std::string name = "/tester03-" + std::to_string(::getpid()) + "-" +
+                     std::to_string(counter++);
+
+  int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0)
+    return nullptr;
+
+  void *memory = MAP_FAILED;
+  if (::ftruncate(fd, sizeof(shm::Channel)) == 0)
+    memory = ::mmap(nullptr, sizeof(shm::Channel), PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0);
+  ::close(fd);
+
+  if (memory == MAP_FAILED) {
+    ::shm_unlink(name.c_str());
+    return nullptr;
+  }
+
+  auto *channel = new (memory) shm::Channel{};
+  return std::unique_ptr<ShmTransport>(
+      new ShmTransport(std::move(name), channel));
+}
+
+ShmTransport::~ShmTransport() {
+  ::munmap(m_channel, sizeof(shm::Channel));
+  ::shm_unlink(m_name.c_str());
+}
+
+bool ShmTransport::wait_attached(std::chrono::milliseconds timeout) {
+  auto const until = std::chrono::steady_clock::now() + timeout;
+  while (m_channel->attached.load(std::memory_order_acquire) == 0) {
+    auto const remaining = until - std::chrono::steady_clock::now();
+    if (remaining <= std::chrono::nanoseconds::zero())
+      return false;
+    shm::futex_wait(
+        &m_channel->attached, 0,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(remaining));
+  }
+  return true;
+}
+
+bool ShmTransport::write(std::string_view text,
+                         std::chrono::nanoseconds timeout) {
+  auto const until = std::chrono::steady_clock::now() + timeout;
+  while (true) {
+    text.remove_prefix(m_channel->to_ai.write(text));
+    if (text.empty())
+      return true;
+    auto const remaining = until - std::chrono::steady_clock::now();
+    if (remaining <= std::chrono::nanoseconds::zero() ||
+        !m_channel->to_ai.wait_writable(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(remaining)))
+      return false;
+  }
+}
+
+bool ShmTransport::read_into(LineFramer &framer,
+                             std::chrono::milliseconds timeout) {
+  if (!m_channel->from_ai.wait_readable(timeout))
+    return false;
+
+  // The ring can wrap in the framer, take both parts
+  while (m_channel->from_ai.readable()) {
+    auto area = framer.write_area();
+    if (area.empty())
+      break;
+    framer.commit(m_channel->from_ai.read(area.data(), area.size()));
+  }
+  return true;
+}
@@ -3,6 +3,7 @@
 #include "ftxui/component/component_options.hpp"
 #include "ftxui/component/screen_interactive.hpp"
 #include "programoptions.hpp"
+#include "referenceai.hpp"
 #include "ship.hpp"
 #include "virtualgames.hpp"
 #include "widgets.hpp"
@@ -21,6 +22,8 @@
 #include <ftxui/screen/string.hpp>
 
 #include <algorithm>
+#include <bit>
+#include <cstdint>
 #include <fstream>
 #include <functional>
 #include <ios>
@@ -36,7 +39,7 @@ std::fstream log("data.txt", std::ios_base::out);
 
 std::shared_ptr<Widgets::DynamicTab> Tabs;
 
-void OpenAITab(const VirtualGames &game);
+void OpenAITab(const VirtualGames &game, bool show_histogram);
 
 // std::accumulate(games.begin(), games.end(),
 //                            std::chrono::milliseconds(0),
@@ -54,7 +57,8 @@ ftxui::Component overview_tab(std::vector<VirtualGames> const &games,
   for (auto const &game : games) {
 
     auto ai_button =
-        Button(std::format("AI {}", game.aiid()), std::bind(OpenAITab, game),
+        Button(reference::label(game.program_name(), game.aiid()),
+               std::bind(OpenAITab, game, options.display_histogram),
                ButtonOption::Animated(Color::Palette256::BlueViolet));
     ai_button_vert_container->Add(ai_button);
   }
@@ -90,8 +94,9 @@ ftxui::Component overview_tab(std::vector<VirtualGames> const &games,
     // clang-format on
     std::vector<std::vector<Element>> ai_table_elements;
     std::vector<std::vector<std::string>> data_table_rows;
-    data_table_rows.push_back(
-        {"AI", "Average Guesses", "Won", "Lost", "Repeats"});
+    data_table_rows.push_back({"AI", "Average Guesses", "95% CI", "Stddev",
+                               "Answer mean", "Answer stddev", "Won", "Lost",
+                               "Repeats"});
 
     ai_table_elements.push_back({text("AI ID (click for details)"),
                                  text("Average Guess per game"),
@@ -108,9 +113,14 @@ ftxui::Component overview_tab(std::vector<VirtualGames> const &games,
       // clang-format on
       ++count;
 
+      auto const &guesses = game.global_stats().guesses_per_game;
       data_table_rows.push_back(
-          {std::to_string(game.aiid()),
-           std::to_string(game.global_stats().average_guess_count),
+          {reference::label(game.program_name(), game.aiid()),
+           std::format("{:.2f}", guesses.mean()),
+           std::format("± {:.2f}", guesses.ci95()),
+           std::format("{:.2f}", guesses.stddev()),
+           std::format("{:.0f}us", game.global_stats().answer_times.mean()),
+           std::format("{:.0f}us", game.global_stats().answer_times.stddev()),
            std::to_string(game.global_stats().ending_state(
                VirtualGames::EndingState::sunk_all_ships)),
            std::to_string(game.global_stats().ending_state(
@@ -171,10 +181,13 @@ ftxui::Component game_tab(const VirtualGames &definition,
                                       "Time"};
   std::vector<std::string> values;
 
-  values.reserve(game.guesses.size() * headers.size());
+  // Decoded once, the renderer looks up the selected guess on every frame
+  auto const view = definition.guesses_of(game);
+  std::vector<VirtualGames::Guess_Stats> guesses(view.begin(), view.end());
+  values.reserve(guesses.size() * headers.size());
 
   std::size_t count = 1;
-  for (auto const &round : game.guesses) {
+  for (auto const &round : guesses) {
     values.push_back(std::format("{}", count));
     values.push_back(round.guess.as_base26_fmt());
     values.push_back(round.result_as_string());
@@ -194,23 +207,41 @@ ftxui::Component game_tab(const VirtualGames &definition,
       ResizableSplitLeft(right_side, left_side, &right_side->left_size);
 
   return Renderer(splitter, [splitter, right_side, left_side, &game,
-                             &definition]() {
+                             &definition, guesses = std::move(guesses)]() {
     std::vector<Widgets::GameBoard::DisplayPoint> points;
-    auto active_point = game.guesses[right_side->get_selected_row()];
+    // A --stats-only game has no guesses to point at
+    auto const selected = right_side->get_selected_row();
+    auto const *active_point =
+        selected < guesses.size() ? &guesses[selected] : nullptr;
+
+    // Too large to draw, one line per ship and the selected guess
+    if (!definition.board_drawable()) {
+      if (active_point)
+        points.emplace_back(
+            get_color_on_status(active_point->result), Color(0, 0, 0),
+            std::format("X {}", active_point->guess.as_base26_fmt()));
+      for (auto const &ship : definition.ships_of(game)) {
+        points.emplace_back(Color(200, 200, 80), Color(0, 0, 0, 0),
+                            std::format("{} at {} {}", ship.size,
+                                        ship.first_cell().as_base26_fmt(),
+                                        ship.across ? "across" : "down"));
+      }
+      if (!points.empty())
+        left_side->set_board(std::move(points), 1);
+      return splitter->Render();
+    }
+
     for (std::size_t row = 0; row < definition.layout().nbrRows.size; ++row) {
       for (std::size_t col = 0; col < definition.layout().nbrCols.size; ++col) {
-        auto status = battleship::shot_at(
-            game.ships, battleship::RowCol{
-                            battleship::Row{static_cast<unsigned short>(row)},
-                            battleship::Col{static_cast<unsigned short>(col)}});
-
-        if (active_point.guess.row.size == row &&
-            active_point.guess.col.size == col) {
-          points.emplace_back(get_color_on_status(active_point.result),
+        auto const ship_size = definition.ship_size_at(game, row, col);
+
+        if (active_point && active_point->guess.row.size == row &&
+            active_point->guess.col.size == col) {
+          points.emplace_back(get_color_on_status(active_point->result),
                               Color(0, 0, 0), "X");
-        } else if (status.id.size != 0) {
+        } else if (ship_size != 0) {
           points.emplace_back(Color(200, 200, 80), Color(0, 0, 0, 0),
-                              std::to_string(status.id.size));
+                              std::to_string(ship_size));
         } else {
           points.emplace_back(Color(0, 0, 0), Color(0, 0, 0, 0), " ");
         }
@@ -223,7 +254,71 @@ ftxui::Component game_tab(const VirtualGames &definition,
   });
 };
 
-ftxui::Component ai_tab(const VirtualGames &games) {
+// p50 to p99.9 of the answer times of the AI, overall and by phase
+std::vector<std::vector<std::string>> latency_rows(const VirtualGames &games) {
+  std::vector<std::vector<std::string>> rows{
+      {"Phase", "Answers", "p50", "p90", "p99", "p99.9"}};
+  auto add_row = [&rows](std::string name, LatencyHistogram const &histogram) {
+    rows.push_back({std::move(name), std::to_string(histogram.count()),
+                    std::format("{}", histogram.percentile(0.5)),
+                    std::format("{}", histogram.percentile(0.9)),
+                    std::format("{}", histogram.percentile(0.99)),
+                    std::format("{}", histogram.percentile(0.999))});
+  };
+
+  add_row("All", games.global_stats().all_latency());
+  if (auto const &harness = games.global_stats().harness;
+      harness.count() > 0)
+    rows.push_back({"Harness (echo_ai)", std::to_string(harness.count()),
+                    std::format("mean {:.1f}us", harness.mean()), "", "", ""});
+  for (std::size_t phase = 0; phase < VirtualGames::Phase_Count; ++phase) {
+    auto const &histogram = games.global_stats().latency[phase];
+    if (histogram.count() > 0)
+      add_row(
+          VirtualGames::Phase_ToString(static_cast<VirtualGames::Phase>(phase)),
+          histogram);
+  }
+  return rows;
+}
+
+// One bar per power of two of answer time
+ftxui::Element latency_bars(LatencyHistogram const &histogram) {
+  using namespace ftxui;
+
+  std::vector<std::pair<std::string, std::uint64_t>> rows;
+  std::uint64_t previous_start{0};
+  for (std::size_t bucket = 0; bucket < LatencyHistogram::bucket_count;
+       ++bucket) {
+    auto const from = LatencyHistogram::lower_bound(bucket);
+    auto const row_start = from == 0 ? 0 : std::bit_floor(from);
+    if (rows.empty() || row_start != previous_start)
+      rows.emplace_back(std::format("{}us", row_start), 0);
+    previous_start = row_start;
+    rows.back().second += histogram.count(bucket);
+  }
+  while (!rows.empty() && rows.back().second == 0)
+    rows.pop_back();
+  auto const first = std::ranges::find_if(
+      rows, [](auto const &row) { return row.second != 0; });
+  rows.erase(rows.begin(), first);
+  if (rows.empty())
+    return text("No answers");
+
+  auto const highest = std::ranges::max(rows, {}, [](auto const &row) {
+                         return row.second;
+                       }).second;
+  Elements bars;
+  for (auto const &[from, count] : rows) {
+    bars.push_back(hbox({text(from) | size(WIDTH, EQUAL, 14),
+                         gauge(static_cast<float>(count) /
+                               static_cast<float>(highest)) |
+                             flex,
+                         text(" " + std::to_string(count))}));
+  }
+  return vbox(std::move(bars));
+}
+
+ftxui::Component ai_tab(const VirtualGames &games, bool show_histogram) {
   using namespace ftxui;
 
   std::vector<std::string> data;
@@ -234,7 +329,7 @@ ftxui::Component ai_tab(const VirtualGames &games) {
     ++count;
     data.push_back(std::to_string(count));
     data.push_back(VirtualGames::EndingState_ToString(game.ending_state));
-    data.push_back(std::to_string(game.guesses.size()));
+    data.push_back(std::to_string(game.stats.total_guess_count));
   }
 
   auto left_side =
@@ -242,7 +337,8 @@ ftxui::Component ai_tab(const VirtualGames &games) {
 
   auto show_active_game_tab = [left_side, &games]() {
     Tabs->add_tab(
-        std::format("AI: {}, Game {}", games.aiid(),
+        std::format("{}, Game {}",
+                    reference::label(games.program_name(), games.aiid()),
                     left_side->get_selected_row() + 1),
         true,
         game_tab(games, games.all_games()[left_side->get_selected_row()]));
@@ -252,8 +348,11 @@ ftxui::Component ai_tab(const VirtualGames &games) {
 
   auto right_button = Button("Show Game details", show_active_game_tab);
 
+  auto const latency = latency_rows(games);
+
   auto right_details = Renderer(right_button, [right_button, left_side,
-                                               &games]() {
+                                               &games, latency,
+                                               show_histogram]() {
     std::vector<std::vector<std::string>> table_data;
 
     auto game = games.all_games()[left_side->get_selected_row()];
@@ -261,32 +360,47 @@ ftxui::Component ai_tab(const VirtualGames &games) {
     table_data.push_back({"Ending State:", VirtualGames::EndingState_ToString(
                                                game.ending_state)});
     table_data.push_back(
-        {"Total guesses:", std::to_string(game.guesses.size())});
+        {"Total guesses:", std::to_string(game.stats.total_guess_count)});
     table_data.push_back(
         {"Total Time:", std::format("{}", game.stats.total_time)});
     table_data.push_back({"Invalid Guess count:",
                           std::format("{}", game.stats.invalid_guess_count)});
     table_data.push_back({"Repeat Guess count:",
                           std::format("{}", game.stats.repeat_guess_count)});
+    table_data.push_back({"Early Guess count:",
+                          std::format("{}", game.stats.early_guess_count)});
     table_data.push_back(
         {"Longest answer time:", std::format("{}", game.stats.longest_answer)});
     table_data.push_back({"Shortest answer time:",
                           std::format("{}", game.stats.shortest_answer)});
     table_data.push_back(
         {"Average answer time", std::format("{}", game.stats.avg_answer)});
+    if (game.stats.timed_budget)
+      table_data.push_back(
+          {"Budget left:", std::format("{}", game.stats.budget_left)});
 
     auto table = Table(table_data);
     table.SelectAll().Border(LIGHT);
     table.SelectAll().Separator(LIGHT);
 
-    return vbox({right_button->Render(), table.Render()});
+    auto latency_table = Table(latency);
+    latency_table.SelectAll().Border(LIGHT);
+    latency_table.SelectAll().Separator(LIGHT);
+
+    Elements details{right_button->Render(), table.Render(),
+                     text("Answer time of the AI") | bold,
+                     latency_table.Render()};
+    if (show_histogram)
+      details.push_back(latency_bars(games.global_stats().all_latency()));
+    return vbox(std::move(details));
   });
 
   return ResizableSplitLeft(left_side, right_details, &left_side->left_size);
 };
 
-void OpenAITab(const VirtualGames &game) {
-  Tabs->add_tab(std::format("AI ID {}", game.aiid()), true, ai_tab(game));
+void OpenAITab(const VirtualGames &game, bool show_histogram) {
+  Tabs->add_tab(reference::label(game.program_name(), game.aiid()), true,
+                ai_tab(game, show_histogram));
 }
 
 void start(ProgramOptions::Options const &opt, std::vector<VirtualGames> &games)
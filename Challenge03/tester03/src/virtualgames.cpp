@@ -5,23 +5,43 @@
 #include <iostream>
 
 void VirtualGames::new_game() {
-  // Get the last number of guess from last run
-
+  // The scratch vectors keep their capacity from one game to the next. A
+  // dense board reserves every guess a game can record, one past
+  // max_guesses(), so recording a guess never allocates. The guesses of a
+  // large board grow with the game and keep the capacity of the longest one.
   m_current.guesses.clear();
+  if (!m_stats_only && dense())
+    m_current.guesses.reserve(max_guesses() + 1);
+  m_invalid.clear();
 
-  if (m_games.size() > 0) {
-    std::size_t reserve = m_games.back().guesses.size();
-    m_current.guesses.reserve(reserve);
-  } else {
-    std::size_t reserve = m_layout.nbrRows.size * m_layout.nbrCols.size + 10;
-    m_current.guesses.reserve(reserve);
-  }
   m_current.stats = VirtualGames::VirtualStats{};
   m_current.start_time = VirtualGames::ClockT::now();
-  if (auto ships = battleship::random_ships(m_layout); ships) {
-    m_current.ships = ships.value();
-    m_current.hits = make_hits_component(m_current.ships);
+  auto const smallest = m_layout.minShipSize.size;
+  auto const sizes = m_layout.maxShipSize.size >= smallest
+                         ? m_layout.maxShipSize.size - smallest + 1
+                         : 0;
+  // Water on the cells of the previous game, then the new ships. Ships
+  // that found no room leave an empty board, not the previous one: every
+  // ship counts as sunk so the runner ends the game at its first guess, as
+  // ships_not_placed.
+  mark_board(m_current.ships, 0);
+  m_placed = shipindex::random_fill(m_index, m_layout);
+  if (!m_placed)
+    m_index.clear();
+  m_current.ships = m_index.placements();
+  if (dense()) {
+    mark_board(m_current.ships);
+    m_state.reset(m_board, smallest, m_index.size());
+  } else {
+    m_state.reset(m_index, m_layout.nbrCols.size, smallest, sizes);
   }
+  m_state.visit([this]<class State>(State const &state) {
+    m_apply = &VirtualGames::apply_guess<State>;
+    m_all_sunk = state.all_sunk();
+  });
+  m_damaged.assign(sizes, false);
+  m_damaged_count = 0;
+  m_any_hit = false;
   m_current.ending_state = EndingState::none;
 
   start_guess_timer();
@@ -32,93 +52,244 @@ void VirtualGames::start_guess_timer() {
 }
 
 void VirtualGames::end_game(VirtualGames::EndingState state) {
-  calculate_stats(m_current);
+  if (!m_placed)
+    state = EndingState::ships_not_placed;
+  calculate_stats(m_current.stats);
   m_current.ending_state = state;
   m_global.set_ending_state(state);
-  m_games.push_back(std::move(m_current));
+  store(m_current);
 }
 
-void VirtualGames::calculate_stats(Game &g) {
-  if (g.guesses.size() < 1)
-    return;
+// Copies the columns of other, the offsets of its games change
+void VirtualGames::merge(VirtualGames const &other) {
+  m_games.reserve(m_games.size() + other.m_games.size());
+  for (auto const &game : other.m_games) {
+    auto &copy = m_games.emplace_back(game);
+    copy.guesses = m_history.append(other.guesses_of(game));
+    auto const ships = other.ships_of(game);
+    copy.ships = m_ships.size();
+    m_ships.insert(m_ships.end(), ships.begin(), ships.end());
+  }
+  m_global += other.m_global;
+}
 
-  g.stats.avg_answer = g.guesses.front().elapsed_time;
-  for (auto &guess : g.guesses) {
-    g.stats.shortest_answer =
-        std::min(g.stats.shortest_answer, guess.elapsed_time);
-    g.stats.longest_answer =
-        std::max(g.stats.longest_answer, guess.elapsed_time);
-    g.stats.avg_answer = (g.stats.avg_answer + guess.elapsed_time) / 2;
-    g.stats.total_time += guess.elapsed_time;
+void VirtualGames::restore_game(PlayedGame game) {
+  if (!game.guesses.empty()) {
+    auto &stats = game.stats;
+    stats.total_guess_count = game.guesses.size();
+    stats.total_time = TimeT{0};
+    stats.shortest_answer = VirtualStats{}.shortest_answer;
+    stats.longest_answer = TimeT{0};
+    stats.answer_times = RunningStats{};
+    for (auto const &guess : game.guesses) {
+      stats.shortest_answer =
+          std::min(stats.shortest_answer, guess.elapsed_time);
+      stats.longest_answer = std::max(stats.longest_answer, guess.elapsed_time);
+      stats.total_time += guess.elapsed_time;
+      stats.answer_times.add(static_cast<double>(guess.elapsed_time.count()));
+    }
   }
-  g.stats.total_guess_count = g.guesses.size();
+  calculate_stats(game.stats);
+  m_global.set_ending_state(game.ending_state);
+  store(game);
+}
 
-  m_global += g.stats;
+void VirtualGames::store(PlayedGame const &game) {
+  Game &stored = m_games.emplace_back();
+  stored.start_time = game.start_time;
+  stored.stats = game.stats;
+  stored.ending_state = game.ending_state;
+  if (m_stats_only)
+    return;
+
+  stored.guesses = m_history.append(game.guesses);
+  stored.ships = m_ships.size();
+  stored.ship_count = game.ships.size();
+  m_ships.insert(m_ships.end(), game.ships.begin(), game.ships.end());
+}
+
+// The totals are kept up to date by apply_guess. Every game counts for the
+// averages, even one ended before its first guess.
+void VirtualGames::calculate_stats(VirtualStats &stats) {
+  if (stats.total_guess_count > 0)
+    stats.avg_answer =
+        stats.total_time / static_cast<TimeT::rep>(stats.total_guess_count);
+
+  m_global += stats;
 };
 
 VirtualGames::GuessResult VirtualGames::guess(const battleship::RowCol guess) {
   auto elapsed_time = VirtualGames::ClockT::now() - m_guess_time;
-  m_current.guesses.emplace_back(
+  ++m_current.stats.turn_count;
+  return (this->*m_apply)(
       guess, std::chrono::duration_cast<VirtualGames::TimeT>(elapsed_time));
+}
 
-  // See if the guess is valid
-  if (!m_layout.is_row_col_valid(guess)) {
-    ++m_current.stats.invalid_guess_count;
-    m_current.guesses.back().result = Guess_Stats_Result::invalid;
-  }
+std::size_t
+VirtualGames::guess_salvo(std::span<const battleship::RowCol> guesses,
+                          std::span<GuessResult> results) {
+  if (guesses.empty())
+    return 0;
+  auto elapsed_time = std::chrono::duration_cast<VirtualGames::TimeT>(
+      VirtualGames::ClockT::now() - m_guess_time);
+  auto const per_shot =
+      elapsed_time / static_cast<TimeT::rep>(guesses.size());
+  ++m_current.stats.turn_count;
 
-  // Find repeats. Can be slow with large numbers of guesses. For modern
-  // computers should be no problem
-  if (auto exists = std::ranges::find(m_current.guesses.begin(),
-                                      m_current.guesses.end() - 1, guess,
-                                      &Guess_Stats::guess);
-      exists != m_current.guesses.end() - 1) {
-    ++m_current.stats.repeat_guess_count;
+  std::size_t shots{0};
+  while (shots < guesses.size() && shots < results.size()) {
+    results[shots] = (this->*m_apply)(guesses[shots], per_shot);
+    ++shots;
+    if (sunk_all_ships())
+      break;
+  }
+  return shots;
+}
 
-    m_current.guesses.back().result = Guess_Stats_Result::repeat;
+template <class State>
+VirtualGames::GuessResult
+VirtualGames::apply_guess(const battleship::RowCol guess,
+                          VirtualGames::TimeT elapsed_time) {
+  auto &stats = m_current.stats;
+  ++stats.total_guess_count;
+  stats.total_time += elapsed_time;
+  stats.shortest_answer = std::min(stats.shortest_answer, elapsed_time);
+  stats.longest_answer = std::max(stats.longest_answer, elapsed_time);
+  stats.answer_times.add(static_cast<double>(elapsed_time.count()));
+  if (m_games.size() >= m_warmup_games) {
+    auto const phase = !m_any_hit           ? Phase::opening
+                       : m_damaged_count > 0 ? Phase::target
+                                             : Phase::hunt;
+    m_global.latency[static_cast<std::size_t>(phase)].record(elapsed_time);
   }
 
-  if (auto ship_opt = battleship::ship_at_position(m_current.ships, guess);
-      ship_opt) {
+  auto record = [&](Guess_Stats_Result result) {
+    if (!m_stats_only)
+      m_current.guesses.push_back({guess, elapsed_time, result});
+  };
 
-    auto shipdef = ship_opt.value().id();
-    auto index = m_layout.shipdef_to_index(shipdef);
+  // See if the guess is valid. Only an invalid guess can not be looked up on
+  // the board, it can only repeat an earlier invalid guess.
+  if (!m_layout.is_row_col_valid(guess)) {
+    ++stats.invalid_guess_count;
+    if (std::ranges::find(m_invalid, guess) != m_invalid.end()) {
+      ++stats.repeat_guess_count;
+      record(Guess_Stats_Result::repeat);
+    } else {
+      m_invalid.push_back(guess);
+      record(Guess_Stats_Result::invalid);
+    }
+    return {GuessReport::Miss};
+  }
 
-    if (auto section_opt = m_current.ships[index].ship_section_hit(guess);
-        section_opt) {
-      m_current.hits[index].hits.set(section_opt.value(), true);
-      if (m_current.hits[index].is_sunk()) {
-        m_current.guesses.back().result = Guess_Stats_Result::sunk;
-        return {GuessReport::Sink, shipdef};
+  auto const cell = static_cast<std::size_t>(guess.row.size) *
+                        m_layout.nbrCols.size +
+                    guess.col.size;
+  auto &state = m_state.get<State>();
+  auto const shot = state.shoot(cell);
+  m_all_sunk = state.all_sunk();
+  if (shot.repeat)
+    ++stats.repeat_guess_count;
 
-      } else {
-        m_current.guesses.back().result = Guess_Stats_Result::hit;
-        return {GuessReport::Hit, shipdef};
+  if (shot.ship != boardstate::Shot::no_ship) {
+    if (!shot.repeat && shot.ship < m_damaged.size()) {
+      m_any_hit = true;
+      if (shot.sunk && m_damaged[shot.ship]) {
+        m_damaged[shot.ship] = false;
+        --m_damaged_count;
+      } else if (!shot.sunk && !m_damaged[shot.ship]) {
+        m_damaged[shot.ship] = true;
+        ++m_damaged_count;
       }
     }
+    battleship::ShipDefinition const shipdef{shot.ship +
+                                             m_layout.minShipSize.size};
+    if (shot.sunk) {
+      record(Guess_Stats_Result::sunk);
+      return {GuessReport::Sink, shipdef};
+    }
+    record(Guess_Stats_Result::hit);
+    return {GuessReport::Hit, shipdef};
   }
-  if (m_current.guesses.back().result == Guess_Stats_Result::unknown)
-    m_current.guesses.back().result = Guess_Stats_Result::miss;
+  record(shot.repeat ? Guess_Stats_Result::repeat : Guess_Stats_Result::miss);
   return {GuessReport::Miss};
 }
 
-VirtualGames::ShipHits
-VirtualGames::make_hits_component(battleship::Ships const &ships) {
-  ShipHits hits;
-  hits.reserve(ships.size());
-  battleship::ShipDefinition sid = m_layout.minShipSize;
+// Walks the cells of each ship only, the board is never scanned
+void VirtualGames::mark_board(std::span<const ShipPlacement> ships,
+                              std::optional<std::uint8_t> value) {
+  if (!dense())
+    return;
+  if (m_board.size() != nbr_cells())
+    m_board.assign(nbr_cells(), 0);
+  std::size_t const cols = m_layout.nbrCols.size;
   for (auto const &ship : ships) {
-    hits.emplace_back(std::bitset<32>{}, sid);
-    ++sid.size;
+    auto const step = ship.across ? 1 : cols;
+    auto cell = ship.row * cols + ship.col;
+    for (std::size_t part = 0; part < ship.size; ++part, cell += step)
+      m_board[cell] = value.value_or(static_cast<std::uint8_t>(ship.size));
   }
-  return hits;
 }
 
 bool VirtualGames::sunk_all_ships() const {
   // for (auto &h : m_current.hits) {
   //   std::cout << h.id.size << " " << h.is_sunk() << '\n';
   // }
-  return std::ranges::all_of(m_current.hits,
+  return m_all_sunk;
+}
+
+namespace {
+std::uint64_t zigzag(std::int64_t value) {
+  return (static_cast<std::uint64_t>(value) << 1) ^
+         static_cast<std::uint64_t>(value >> 63);
+}
+
+std::int64_t unzigzag(std::uint64_t value) {
+  return static_cast<std::int64_t>(value >> 1) ^
+         -static_cast<std::int64_t>(value & 1);
+}
+} // namespace
+
+void VirtualGames::History::push(Guess_Stats const &guess, TimeT previous) {
+  auto const index = m_cells.size();
+  m_cells.push_back(static_cast<std::uint32_t>(guess.guess.row.size) << 16 |
+                    static_cast<std::uint32_t>(guess.guess.col.size & 0xFFFF));
+
+  auto const code = static_cast<std::uint8_t>(guess.result) & 0x0F;
+  if (index % 2 == 0)
+    m_results.push_back(code);
+  else
+    m_results.back() |= static_cast<std::uint8_t>(code << 4);
+
+  // LEB128, 7 bits per byte, the high bit set when more bytes follow
+  auto delta = zigzag((guess.elapsed_time - previous).count());
+  while (delta >= 0x80) {
+    m_latency.push_back(static_cast<std::uint8_t>(delta | 0x80));
+    delta >>= 7;
+  }
+  m_latency.push_back(static_cast<std::uint8_t>(delta));
+}
+
+VirtualGames::Guess_Stats
+VirtualGames::History::decode(std::size_t index, TimeT elapsed) const {
+  auto const cell = m_cells[index];
+  auto const code = (m_results[index / 2] >> (index % 2 * 4)) & 0x0F;
+  return {battleship::RowCol{
+              battleship::Row{static_cast<battleship::Row::type>(cell >> 16)},
+              battleship::Col{
+                  static_cast<battleship::Col::type>(cell & 0xFFFF)}},
+          elapsed, static_cast<Guess_Stats_Result>(code)};
+}
 
-                             [](auto &hit) { return hit.is_sunk(); });
+VirtualGames::TimeT
+VirtualGames::History::read_latency(std::size_t &offset) const {
+  std::uint64_t delta{0};
+  int shift{0};
+  std::uint8_t byte{0};
+  do {
+    byte = m_latency[offset++];
+    delta |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  return TimeT{unzigzag(delta)};
 }
@@ -0,0 +1,194 @@
+// Feeds LineFramer the way EventLoopRunner does, through write_area() and
+// commit(), and checks the lines it hands back
+
+#include "lineframer.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, char const *what, int line) {
+  if (!ok) {
+    std::printf("line %d: %s\n", line, what);
+    ++failures;
+  }
+}
+
+#define CHECK(expr) check((expr), #expr, __LINE__)
+
+// One read() of the AI output, split when the ring wraps like the event
+// loop reads again after commit()
+void receive(LineFramer &framer, std::string_view bytes) {
+  while (!bytes.empty()) {
+    auto area = framer.write_area();
+    auto const count = std::min(area.size(), bytes.size());
+    std::copy_n(bytes.data(), count, area.data());
+    framer.commit(count);
+    bytes.remove_prefix(count);
+  }
+}
+
+bool next_is(LineFramer &framer, std::string_view expected) {
+  auto line = framer.next_line();
+  return line && *line == expected;
+}
+
+void split_across_reads() {
+  LineFramer framer;
+  receive(framer, "B");
+  CHECK(!framer.next_line());
+  receive(framer, "7");
+  CHECK(!framer.next_line());
+  receive(framer, "\n");
+  CHECK(next_is(framer, "B7"));
+  CHECK(!framer.next_line());
+  CHECK(framer.size() == 0);
+}
+
+void several_lines_in_one_read() {
+  LineFramer framer;
+  receive(framer, "A1\nB2\nC3\nD");
+  CHECK(framer.pending_lines() == 3);
+  CHECK(next_is(framer, "A1"));
+  CHECK(next_is(framer, "B2"));
+  CHECK(next_is(framer, "C3"));
+  CHECK(!framer.next_line());
+  receive(framer, "4\n");
+  CHECK(next_is(framer, "D4"));
+}
+
+void carriage_return_line_feed() {
+  LineFramer framer;
+  receive(framer, "A1\r\n\r\nb2\n");
+  CHECK(next_is(framer, "A1"));
+  CHECK(next_is(framer, ""));
+  CHECK(next_is(framer, "b2"));
+
+  // "\r" and "\n" in different reads
+  receive(framer, "C3\r");
+  CHECK(!framer.next_line());
+  receive(framer, "\n");
+  CHECK(next_is(framer, "C3"));
+}
+
+void ring_wraparound() {
+  LineFramer framer;
+  // Moves the ring position to 10 bytes before its end
+  std::string const filler(LineFramer::capacity - 11, 'x');
+  receive(framer, filler + "\n");
+  CHECK(next_is(framer, filler));
+  CHECK(framer.write_area().size() == 10);
+
+  // Lines that cross the end of the ring come back in one piece
+  receive(framer, "J100\nAB12345\nC7\n");
+  CHECK(next_is(framer, "J100"));
+  CHECK(next_is(framer, "AB12345"));
+  CHECK(next_is(framer, "C7"));
+  CHECK(framer.size() == 0);
+
+  // A line of the whole ring wraps too
+  std::string const longest(LineFramer::capacity - 1, 'y');
+  receive(framer, longest + "\n");
+  CHECK(framer.full());
+  CHECK(next_is(framer, longest));
+
+  // Full without a line
+  receive(framer, std::string(LineFramer::capacity, 'z'));
+  CHECK(framer.full());
+  CHECK(!framer.next_line());
+  CHECK(framer.write_area().empty());
+}
+
+void drops_stale_lines() {
+  LineFramer framer;
+  framer.set_line_per_reply(true);
+
+  // Three replies sent, one answered, one buffered, one still on its way
+  framer.reply_sent();
+  framer.reply_sent();
+  framer.reply_sent();
+  receive(framer, "A1\nA2\n");
+  CHECK(next_is(framer, "A1"));
+  framer.start_game();
+  CHECK(framer.pending_lines() == 0);
+  CHECK(framer.stale_lines() == 1);
+
+  // The late answer is dropped as it arrives, in pieces or not
+  framer.reply_sent();
+  receive(framer, "A");
+  receive(framer, "3\nB1\n");
+  CHECK(framer.stale_lines() == 0);
+  CHECK(next_is(framer, "B1"));
+  CHECK(!framer.next_line());
+
+  // A partial line at the end of a game is stale too
+  framer.reply_sent();
+  receive(framer, "B2\nB");
+  CHECK(next_is(framer, "B2"));
+  framer.start_game();
+  CHECK(framer.stale_lines() == 1);
+  framer.reply_sent();
+  receive(framer, "3\nC1\n");
+  CHECK(next_is(framer, "C1"));
+
+  // Lines sent ahead of their reply belong to the game that is ending
+  framer.reply_sent();
+  receive(framer, "C2\nC3\nC4\n");
+  framer.start_game();
+  CHECK(framer.pending_lines() == 0);
+  CHECK(framer.stale_lines() == 0);
+  framer.reply_sent();
+  receive(framer, "D1\n");
+  CHECK(next_is(framer, "D1"));
+}
+
+// Without --line-per-reply the AI may leave the final S unanswered, the
+// lines it owes are not dropped
+void owes_nothing_by_default() {
+  LineFramer framer;
+
+  // E and two answers sent, the AI stopped after sinking its last ship
+  framer.reply_sent();
+  framer.reply_sent();
+  framer.reply_sent();
+  receive(framer, "A1\n");
+  CHECK(next_is(framer, "A1"));
+  framer.start_game();
+  CHECK(framer.stale_lines() == 0);
+
+  // The answer to the next E is played
+  framer.reply_sent();
+  receive(framer, "B1\n");
+  CHECK(next_is(framer, "B1"));
+
+  // Lines already buffered and a partial line are still dropped
+  receive(framer, "B2\nB");
+  framer.start_game();
+  CHECK(framer.pending_lines() == 0);
+  CHECK(framer.stale_lines() == 1);
+  receive(framer, "3\nC1\n");
+  CHECK(next_is(framer, "C1"));
+}
+
+} // namespace
+
+int main() {
+  split_across_reads();
+  several_lines_in_one_read();
+  carriage_return_line_feed();
+  ring_wraparound();
+  drops_stale_lines();
+  owes_nothing_by_default();
+
+  if (failures > 0) {
+    std::printf("%d checks failed\n", failures);
+    return 1;
+  }
+  std::printf("lineframer: all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,142 @@
+// Plays the AI side of a ShmTransport channel, mapped by name as an AI does,
+// and checks that replies reach it whole when the ring is full
+
+#include "shmtransport.hpp"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, char const *what, int line) {
+  if (!ok) {
+    std::printf("line %d: %s\n", line, what);
+    ++failures;
+  }
+}
+
+#define CHECK(expr) check((expr), #expr, __LINE__)
+
+using namespace std::chrono_literals;
+
+shm::Channel *attach(ShmTransport const &transport) {
+  int fd = ::shm_open(transport.name().c_str(), O_RDWR, 0600);
+  if (fd < 0)
+    return nullptr;
+  void *memory = ::mmap(nullptr, sizeof(shm::Channel), PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd, 0);
+  ::close(fd);
+  return memory == MAP_FAILED ? nullptr : static_cast<shm::Channel *>(memory);
+}
+
+void detach(shm::Channel *channel) {
+  ::munmap(channel, sizeof(shm::Channel));
+}
+
+// Everything in the to_ai ring, waiting up to timeout for the first byte
+std::string drain(shm::Ring &ring, std::chrono::nanoseconds timeout) {
+  std::string text;
+  char chunk[shm::Ring::capacity];
+  if (!ring.wait_readable(timeout))
+    return text;
+  while (ring.readable())
+    text.append(chunk, ring.read(chunk, sizeof(chunk)));
+  return text;
+}
+
+void waits_for_room() {
+  auto transport = ShmTransport::create();
+  CHECK(transport != nullptr);
+  if (!transport)
+    return;
+  auto *channel = attach(*transport);
+  CHECK(channel != nullptr);
+  if (!channel)
+    return;
+
+  // The AI has not read the last replies, two bytes of room are left
+  std::string const unread(shm::Ring::capacity - 2, 'M');
+  CHECK(transport->write(unread, 0ms));
+
+  std::string const expected = unread + "S12\nE\n";
+  std::string received;
+  std::thread ai{[&] {
+    std::this_thread::sleep_for(20ms);
+    while (received.size() < expected.size()) {
+      auto part = drain(channel->to_ai, 1s);
+      if (part.empty())
+        break;
+      received += part;
+    }
+  }};
+  CHECK(transport->write("S12\nE\n", 1s));
+  ai.join();
+  CHECK(received == expected);
+  detach(channel);
+}
+
+void times_out_without_reader() {
+  auto transport = ShmTransport::create();
+  CHECK(transport != nullptr);
+  if (!transport)
+    return;
+
+  std::string const unread(shm::Ring::capacity, 'M');
+  CHECK(transport->write(unread, 0ms));
+  auto const start = std::chrono::steady_clock::now();
+  CHECK(!transport->write("H\n", 10ms));
+  auto const waited = std::chrono::steady_clock::now() - start;
+  CHECK(waited >= 10ms && waited < 1s);
+}
+
+void longer_than_ring() {
+  auto transport = ShmTransport::create();
+  CHECK(transport != nullptr);
+  if (!transport)
+    return;
+  auto *channel = attach(*transport);
+  CHECK(channel != nullptr);
+  if (!channel)
+    return;
+
+  std::string text;
+  while (text.size() < 5 * shm::Ring::capacity)
+    text += "S" + std::to_string(text.size() % 97) + "\n";
+
+  std::string received;
+  std::thread ai{[&] {
+    while (received.size() < text.size()) {
+      auto part = drain(channel->to_ai, 1s);
+      if (part.empty())
+        break;
+      received += part;
+    }
+  }};
+  CHECK(transport->write(text, 1s));
+  ai.join();
+  CHECK(received == text);
+  detach(channel);
+}
+
+} // namespace
+
+int main() {
+  waits_for_room();
+  times_out_without_reader();
+  longer_than_ring();
+
+  if (failures > 0) {
+    std::printf("%d checks failed\n", failures);
+    return 1;
+  }
+  std::printf("shmtransport: all checks passed\n");
+  return 0;
+}